@@ -21,6 +21,64 @@ lconfig supports the following additional options:
     Sets the path of the config file used by lconfig to read/write config values. Default is "config.txt".
 #define LCONFIG_LMAX
     Sets the maximum line length read from the config file, rarely needs to be changed. Default is 512.
+#define LCONFIG_TABLES
+    Path of a tables file generated by lcfggen, used instead of LCONFIG_TEMPLATE (see lconfig tables).
+#define LCONFIG_STATS
+    Enables lconfigStats() and the counters/timings behind it, which are compiled out entirely otherwise.
+    Read is the whole lconfigRead call, parse is finding names, apply is clamping and storing values.
+    Timings use CLOCK_MONOTONIC if <time.h> provides it (POSIX), and the much coarser clock() otherwise.
+#define LCONFIG_PROFILE
+    Enables per-key access profiling through lconfigProfile(), must be set to the sampling period, which
+    must be a power of two (e.g. 64 to count one in every 64 get calls per thread). Sets are always counted.
+    Cheap enough to leave on, the getters only pay for a thread-local counter increment and a branch.
+#define LCONFIG_TRACE
+    Enables lconfigTrace(), which installs hooks called at the begin/end of lconfigRead, of parsing each
+    line, of applying each matched value, and of lconfigWrite. End hooks get byte counts and durations.
+#define LCONFIG_SDT
+    Implies LCONFIG_TRACE and additionally fires USDT probes (provider lconfig) at the same points, for use
+    with perf, bpftrace and similar. Requires <sys/sdt.h>, probes cost a single nop when not attached.
+    Probes: read_begin(path), read_end(bytes, ns), parse_begin(line), parse_end(bytes, ns),
+    apply_begin(type, id), apply_end(type, id, ns), write_begin(path), write_end(bytes, ns).
+#define LCONFIG_DYNAMIC
+    Enables lconfigRegisterInt/lconfigRegisterString, which add config values at runtime (see lconfig
+    dynamic). Uses malloc, registered config values live until the program exits.
+#define LCONFIG_SPANS
+    Makes lconfigRead load the whole config file into one buffer and leave string values in place as spans
+    into it, instead of copying each of them (see lconfig spans). Also removes the LCONFIG_LMAX line limit.
+#define LCONFIG_LOCK
+    Enables advisory locking of the config file (see lconfig locking), must be set to the default lock
+    timeout in milliseconds (-1 waits forever, 0 never waits). Requires POSIX (fcntl, fdopen, ftruncate).
+#define LCONFIG_PATCH
+    Enables lconfigPatch, which updates the existing config file in place instead of rewriting it from the
+    template (see lconfig patch). Requires <sys/stat.h> (POSIX, also provided by Windows). Modification
+    times are compared to the nanosecond with POSIX.1-2008 (e.g. _POSIX_C_SOURCE 200809L, or the default
+    feature set of glibc) and on macOS, otherwise to the second.
+#define LCONFIG_OVERRIDE
+    Enables thread-local override scopes (see lconfig overrides), must be set to the maximum number of
+    overrides plus scopes that can be active at once on a single thread (e.g. 32).
+#define LCONFIG_PARALLEL
+    Makes lconfigRead resolve the names of large config files on several threads (see lconfig parallel),
+    must be set to the maximum number of threads (e.g. 8). Requires POSIX threads.
+#define LCONFIG_PROVENANCE
+    Enables lconfigSource, which tells where the current value of an int or string came from (see lconfig
+    provenance). Costs 4 bytes per config value, kept in side arrays apart from the values themselves.
+#define LCONFIG_CAPTURE
+    Enables lconfigCapture, which records calls into a binary trace file for replay by tools/lcfgreplay.c
+    (see lconfig capture). While no capture is running the getters only pay for one extra branch.
+#define LCONFIG_NUMA
+    Makes lconfigGetInt read from a copy of the int values kept on the NUMA node of the calling thread (see
+    lconfig numa), must be set to the maximum number of nodes (e.g. 4). Requires Linux and POSIX threads,
+    and _GNU_SOURCE (or _DEFAULT_SOURCE) defined before any include for getcpu and MAP_ANONYMOUS, which
+    strict modes like -std=c99 hide otherwise.
+#define LCONFIG_PRELOAD
+    Enables lconfigPreloadAsync, which reads the config file on a helper thread while the program goes on
+    starting up (see lconfig preload). Requires POSIX threads.
+#define LCONFIG_LAZY
+    Makes lconfigRead only remember where template ints and strings are in the config file, decoding each
+    of them on first use (see lconfig lazy). Loads whole files like LCONFIG_SPANS. Requires POSIX threads.
+#define LCONFIG_DURABLE
+    Makes writes flush the config file to disk (see lconfig durability), must be set to the default level
+    (LCONFIG_DNONE, LCONFIG_DDATA or LCONFIG_DFULL). Requires POSIX (fsync, fdatasync, rename).
 
 lconfig init:
     All config values start out at their defaults at program startup. If you wish to read/create the config
@@ -32,6 +90,12 @@ lconfig double:
     can almost always be expressed as scaled integers. For example a value in the range 0.0 to 1.0 could be
     expressed as an integer in the range 0 to 1000 or similar depending on desired resolution of the value.
 
+lconfig ints:
+    Int values in the config file may be decimal, hex with a 0x prefix or binary with a 0b prefix, and are
+    saturated at INT_MIN/INT_MAX before being clamped to MIN/MAX. Anything but whitespace after the digits
+    is counted as invalid by lconfigStats, the value itself is still used. Values without any digits are
+    also counted, but leave the config value unchanged (map entries are skipped in that case).
+
 lconfig template:
     A template is used to tell lconfig what config values exist, what their limits and defaults are, and
     how they are presented in the config file (along with newlines and labels, see examples further down).
@@ -74,6 +138,170 @@ string_a ABCD
 number_b 15
 string_b FOO
 <lconfig example config.txt end>
+
+lconfig maps:
+    LCONFIG_MAP(ID, NAME, NUM, MIN, MAX, DEF) declares a map from arbitrary keys to ints, e.g. per-tenant
+    limits. IDs are separate from int and string IDs. In the config file every entry is a line "NAME KEY
+    VALUE" (keys must not contain spaces), entries are written in the order they were added. Up to NUM
+    entries are kept in an open addressing table, so lconfigMapGet is O(1), values are clamped to MIN/MAX,
+    and keys that are not in the map read as DEF. Reading the config file replaces the whole map (starting
+    out empty), as does lconfigDefault. Tables are allocated on first use, so maps cost nothing until used.
+
+lconfig dynamic:
+    With LCONFIG_DYNAMIC, plugins can register config values at runtime. These get IDs after all template
+    IDs of their type, and take part in reading, writing, defaults, name lookup and iteration just like
+    template config values. Writing puts them after the template, in order of registration. Registration
+    is amortized O(1) (the arrays and the hash index grow geometrically), but it may move internal
+    storage, so it must not run concurrently with any other lconfig call. Names must not contain spaces.
+
+lconfig spans:
+    With LCONFIG_SPANS, string values read from the config file are not copied into their own buffers, but
+    point into a private copy of the file (newlines replaced by NUL terminators, values longer than LEN are
+    cut short in place). A string is only copied into its own buffer when lconfigSetString changes it, when
+    lconfigDefault resets it, or when a later lconfigRead replaces the file buffer without setting it again.
+    Pointers returned by lconfigGetString stay valid until the next lconfigRead, lconfigDefault or set of
+    that value (as without spans, where those overwrite the returned buffer). lconfigGetStringSpan also
+    returns the length, without having to call strlen.
+
+lconfig parallel:
+    With LCONFIG_PARALLEL, lconfigRead loads the whole config file into one buffer (which also removes the
+    LCONFIG_LMAX line limit) and splits it at newlines into one chunk per thread, at least 1 MB each, so
+    small files are still read on the calling thread alone. The threads split their chunks into lines and
+    look up the names, then the calling thread applies all lines in file order, keeping last-wins semantics
+    and everything else about reading exactly as without threads. Lines in front of the first section
+    header of a chunk depend on earlier chunks, so those are looked up while applying instead.
+
+lconfig locking:
+    With LCONFIG_LOCK, lconfigRead takes a shared lock and lconfigWrite an exclusive lock on the config file
+    for as long as they use it, so several processes can share a config file: writers never interleave,
+    and readers wait for a write in progress instead of seeing a partially written file. lconfigWrite only
+    truncates the file once it holds the lock. Locks are fcntl record locks, per open file description
+    (F_OFD_SETLK) where available, so threads of one process exclude each other as well, and per process
+    otherwise. If a lock cannot be taken within the timeout (polling with a backoff of up to 16ms), the call
+    fails with 2 and changes nothing. lconfigTryRead/lconfigTryWrite never wait, lconfigLockTimeout
+    changes the timeout of the other calls. Locks are advisory, other programs editing the file ignore them.
+
+lconfig overrides:
+    With LCONFIG_OVERRIDE, lconfigPush opens a scope on the calling thread, lconfigOverrideInt and
+    lconfigOverrideString then replace config values for that thread only, until the matching lconfigPop.
+    Scopes nest, inner overrides hide outer ones, and other threads keep seeing the global values. Getters
+    check a thread-local count first, so they cost one extra load and branch while no scope is active, and
+    otherwise search the stack from the top, which is bounded by LCONFIG_OVERRIDE and needs no per-thread
+    memory proportional to the number of config values. Sets, reads and writes ignore overrides.
+    String overrides are copied (clamped like sets), so scopes must be popped before a thread exits.
+
+lconfig sections:
+    Names may contain dots to group config values into sections, e.g. "cache.l1_size". In the config file a
+    line "[cache]" starts a section, following names are then looked up as "cache.NAME" first and as plain
+    NAME second, until the next section header ("[]" returns to the top level). Sections nest by using
+    dots in headers ("[cache.l1]"), and headers can be put into templates with LCONFIG_LINE("[cache]").
+    lconfigIterateSection visits every config value in a subtree in name order, using a sorted name index
+    (built on first use like the hash index) so the cost is O(log n) plus the size of the subtree, and
+    lconfigReadSection rereads the config file but only applies values within a subtree.
+
+lconfig sparse:
+    lconfigWriteSparse writes only config values that differ from their defaults (and maps with entries),
+    without any LCONFIG_LINE lines, which keeps files small when most values are left at their defaults.
+    Reading a sparse file gives the same values as reading a full one, as long as the program started from
+    defaults. Values are written in name order, top level names first. If sections are requested, dotted
+    names are grouped under "[section]" headers and written without the section part (see lconfig sections).
+
+lconfig patch:
+    With LCONFIG_PATCH, reading remembers where in the file each int and string value is. lconfigPatch then
+    only touches values that changed since: values of the same length (and shorter ints, padded with spaces)
+    are overwritten in place, and values missing from the file are appended if they differ from their
+    defaults, so the bytes written scale with the change. Only if a value no longer fits is the file rebuilt
+    once, copying everything else verbatim into a temporary file that is renamed over the original. Either
+    way comments, unknown keys and the layout of the file are kept. If the file changed since it was last
+    read (size or modification time differ) its offsets are rescanned first, without applying values, and
+    the old values are read back before they are overwritten, in case a rewrite kept both. Without a file
+    lconfigPatch writes a full one like lconfigWrite. Maps are not patched, changes to maps need
+    lconfigWrite. Patching honours LCONFIG_LOCK, with the file locked exclusively while it is changed.
+    Patches count as writes for LCONFIG_STATS and LCONFIG_TRACE, with only the bytes actually written.
+
+lconfig provenance:
+    With LCONFIG_PROVENANCE every int and string remembers whether its current value is the default, was
+    read from the config file or was set through lconfigSet*, along with the line it was read from and
+    whether it had to be clamped to MIN/MAX (or truncated to LEN). This is recorded as values are applied,
+    so lconfigSource never touches the file. lconfigDefault resets all of them to LCONFIG_SDEF, overrides
+    are not recorded and maps are not tracked. Lines are counted from 1, as seen by lconfigRead.
+
+lconfig capture:
+    With LCONFIG_CAPTURE, lconfigCapture(path) starts recording every lconfigGetInt, lconfigGetString,
+    lconfigSetInt, lconfigSetString (ByName variants included), lconfigRead and lconfigWrite call into the
+    given file, until lconfigCapture(NULL) stops the capture. Other read/write functions are recorded as
+    plain reads/writes. Each thread collects records in its own buffer, which is appended to the file when
+    full or when the capture stops, so records of different threads are not in time order. lconfigCapture
+    itself must not run concurrently with other lconfig calls. The file starts with the 8 bytes "LCFGCAP1",
+    followed by struct lconfig_rec records in native byte order, each LCONFIG_CSETSTR record being followed
+    by len bytes of the string set (not NUL terminated, longer strings are cut to 65535 bytes).
+
+lconfig numa:
+    With LCONFIG_NUMA, every NUMA node gets its own replica of the current values of all template ints,
+    made by the first thread on that node calling lconfigGetInt, so its pages are placed on that node.
+    Getters then read the replica of their node instead of lcfg_ints, and a set only pulls the cache lines
+    it changed over to the other nodes, once per node, instead of every reader on a remote node missing on
+    the same line. Sets, reads and lconfigDefault update all replicas under a mutex along with the value
+    itself, so sets are slower, while getters cost one extra thread-local load and branch. A thread keeps
+    using the replica of the node it first ran a getter on, so reader threads should be pinned to a node
+    (as they usually are on such machines). Nodes beyond LCONFIG_NUMA share replicas (node % LCONFIG_NUMA),
+    strings, maps and dynamic ints are not replicated. Nothing is replicated until the first get.
+
+lconfig preload:
+    With LCONFIG_PRELOAD, lconfigPreloadAsync starts lconfigRead on a helper thread and returns right away,
+    so reading and parsing the config file overlaps with whatever else the program does at startup. Every
+    other lconfig call that reads or changes config values (getters, setters, Find, Iterate, reads and
+    writes) blocks until the preload is done if it is called earlier, so no call can see a partially read
+    file, and afterwards costs a single load and branch. lconfigPreloadWait waits explicitly and returns the
+    result of the read. Only one preload runs at a time, if no thread can be started the file is read on
+    the calling thread instead. Calls made from within trace hooks on the helper thread do not block.
+
+lconfig lazy:
+    With LCONFIG_LAZY, lconfigRead loads the whole config file into one buffer and still looks up the name
+    of every line, but for template ints and strings it only records the offset of the value (4 bytes per
+    config value, kept apart from the values), so reading costs nothing for values the program never uses.
+    The first lconfigGet*, lconfigSet*, lconfigIterate* or lconfigSource of such a value decodes it under a
+    mutex (parsed, clamped and counted by lconfigStats as an eager read would, but only for the last line
+    setting it), later gets only check the offset with a single load and branch. Gets of values pending
+    from a read still in progress wait for it. Writes decode all pending values first, as does the next
+    read before replacing the buffer, so the buffer of the previous read is never kept around. Maps and
+    dynamic config values are decoded right away, lconfigDefault drops pending values. Until decoded,
+    lconfigSource reports values as not clamped. Trace hooks called by a read (LCONFIG_TRACE) run on the
+    reading thread while it holds the mutex, so config values they get that are pending from that read
+    still have their values from before it, instead of waiting for the read forever.
+
+lconfig durability:
+    Without LCONFIG_DURABLE writes end with fclose, so a crash or power loss shortly after may lose them or
+    leave a truncated file behind. With it, lconfigDurability picks one of three levels for all following
+    lconfigWrite, lconfigWriteSparse and lconfigPatch calls. LCONFIG_DNONE writes as before. LCONFIG_DDATA
+    adds an fdatasync of the file before closing it, so the write is on disk once the call returns, but a
+    crash during the write can still leave a partial file. LCONFIG_DFULL writes LCONFIG_PATH ".tmp" instead,
+    fsyncs it, renames it over the config file and fsyncs the directory, so a crash at any point leaves
+    either the old or the new file (with LCONFIG_LOCK the config file stays locked while this happens).
+    lconfigPatch in place syncs the file at both LCONFIG_DDATA and LCONFIG_DFULL, but only its rebuilds are
+    atomic. Syncs cost milliseconds on most disks, so programs writing often can batch them: write at
+    LCONFIG_DNONE as often as needed, and call lconfigSync (fsync of file and directory) once at the points
+    that need to be durable. With LCONFIG_STATS the number and duration of syncs show up in lconfigStats.
+    lconfigSync keeps a descriptor of the config file open between calls (reopened once the file is
+    replaced): with LCONFIG_LOCK but without per open file description locks, closing any descriptor of the
+    file would drop the locks of a write in progress on another thread. It must not be called from several
+    threads at once.
+
+lconfig names:
+    Names are looked up through a hash index, both when reading the config file and in lconfigFind*. With
+    a template the index is built on first use (lconfigRead or lconfigFind*), so in multi-threaded programs
+    either of those should be called once before other threads start using names. Templates with names
+    containing spaces still work, but reading then falls back to comparing each line against every name.
+
+lconfig tables:
+    Every template entry is a macro argument that gets expanded several times, which becomes slow to compile
+    for very large templates (tens of thousands of entries). For those the lcfggen tool (tools/lcfggen.c)
+    can turn a schema file into an ID header and a tables file ahead of time. The tables contain dense IDs,
+    a perfect hash over all names (so reading does one lookup per line instead of comparing every name),
+    a pre-rendered write image, and defaults that are already clamped. To use them, #define LCONFIG_TABLES
+    as the path of the tables file (e.g. "tables.h") instead of defining LCONFIG_TEMPLATE, the path is
+    included from within lconfig.h so its directory may need to be added to the include path. The runtime
+    API is exactly the same either way. The schema format is documented at the top of tools/lcfggen.c.
 */
 
 //header section
@@ -87,6 +315,14 @@ string_b FOO
 #else //LCONFIG_EXTERN
     #define LCONDEF extern
 #endif
+#if defined(LCONFIG_SDT)&&!defined(LCONFIG_TRACE)
+    #define LCONFIG_TRACE
+#endif
+
+//constants
+#define LCONFIG_TINT 1 //type of integer config values
+#define LCONFIG_TSTR 2 //type of string config values
+#define LCONFIG_TMAP 3 //type of map config values
 
 //function declarations
 LCONDEF void lconfigDefault();
@@ -97,6 +333,40 @@ LCONDEF int lconfigRead();
 LCONDEF int lconfigWrite();
     //writes current config values to file if possible, creating the file if needed
     //returns 0 on success, non-zero if the file could not be written
+LCONDEF int lconfigWriteSparse(int);
+    //same as lconfigWrite, but only writes config values that differ from their defaults (see lconfig sparse)
+    //if the argument is non-zero, dotted names are grouped under section headers
+#ifdef LCONFIG_PATCH
+LCONDEF int lconfigPatch();
+    //updates changed config values in the existing file, keeping everything else (see lconfig patch)
+    //returns 0 on success, non-zero if the file could not be written
+#endif
+#ifdef LCONFIG_LOCK
+LCONDEF int lconfigTryRead();
+    //same as lconfigRead, but fails with 2 right away if the file is locked by a writer
+LCONDEF int lconfigTryWrite();
+    //same as lconfigWrite, but fails with 2 right away if the file is locked by anyone else
+LCONDEF void lconfigLockTimeout(int);
+    //sets the lock timeout of lconfigRead, lconfigReadSection and lconfigWrite in milliseconds (-1 forever)
+#endif
+#ifdef LCONFIG_PRELOAD
+LCONDEF int lconfigPreloadAsync();
+    //starts reading the config file on a helper thread, other lconfig calls wait for it (see lconfig preload)
+    //returns 0 if the read was started (or done right away without threads), -1 if one is still running
+LCONDEF int lconfigPreloadWait();
+    //waits until a running preload is done, returns the result of its lconfigRead (0 if there was none)
+#endif
+#ifdef LCONFIG_DURABLE
+#define LCONFIG_DNONE 0 //closes the file only
+#define LCONFIG_DDATA 1 //fdatasync of the file before closing it
+#define LCONFIG_DFULL 2 //temporary file, fsync, rename over the config file and fsync of the directory
+LCONDEF int lconfigDurability(int);
+    //sets the durability level of following writes (see lconfig durability)
+    //returns the previous level, -1 if the given level is invalid (the level is then left unchanged)
+LCONDEF int lconfigSync();
+    //syncs the config file and its directory to disk, making earlier writes at LCONFIG_DNONE durable
+    //returns 0 on success, non-zero if the file could not be synced, keeps a descriptor of the file open
+#endif
 LCONDEF int lconfigGetInt(int);
     //returns the value of the given integer config value (-1 if invalid)
 LCONDEF void lconfigSetInt(int, int);
@@ -105,6 +375,155 @@ LCONDEF const char* lconfigGetString(int);
     //returns the value of the given string config value (NULL if invalid)
 LCONDEF void lconfigSetString(int, const char*);
     //sets the value of the given string config value (subject to clamping)
+LCONDEF int lconfigFindInt(const char*, int);
+    //returns the ID of the integer config value with the given name (-1 if there is none)
+    //the name is given along with its length (-1 if NUL terminated), lookups are O(1) hashed
+LCONDEF int lconfigFindString(const char*, int);
+    //returns the ID of the string config value with the given name (-1 if there is none)
+    //the name is given along with its length (-1 if NUL terminated), lookups are O(1) hashed
+LCONDEF int lconfigFindMap(const char*, int);
+    //same as lconfigFindInt, but for maps
+LCONDEF int lconfigMapGet(int, const char*, int);
+    //returns the value of the given key (length -1 if NUL terminated) in the map with the given ID
+    //returns DEF of the map if the key is not in it, and -1 if there is no map with that ID
+LCONDEF int lconfigMapSet(int, const char*, int, int);
+    //sets the value of the given key in the map with the given ID, the value is clamped to MIN/MAX
+    //returns 0 on success, -1 if there is no such map, the map is full or the key contains a space/newline
+LCONDEF int lconfigGetIntByName(const char*, int);
+    //same as lconfigGetInt, but takes a name and its length as in lconfigFindInt
+LCONDEF void lconfigSetIntByName(const char*, int, int);
+    //same as lconfigSetInt, but takes a name and its length as in lconfigFindInt
+LCONDEF const char* lconfigGetStringByName(const char*, int);
+    //same as lconfigGetString, but takes a name and its length as in lconfigFindString
+LCONDEF void lconfigSetStringByName(const char*, int, const char*);
+    //same as lconfigSetString, but takes a name and its length as in lconfigFindString
+struct lconfig_info {
+    int type; //LCONFIG_TINT, LCONFIG_TSTR or LCONFIG_TMAP
+    int id; //ID of the config value
+    const char* name; //name in config file, not NUL terminated at len
+    int len; //length of name
+    int min, max; //limits of ints and map values, 0 and maximum length (LEN) for strings
+    int def, cur; //default and current value of ints, default and number of entries of maps, 0 for strings
+    const char* sdef; //default value of strings, NULL for ints
+    const char* scur; //current value of strings, NULL for ints
+};
+LCONDEF int lconfigCount();
+    //returns the number of config values in the template
+LCONDEF int lconfigIterate(int*, struct lconfig_info*);
+    //fills in the config value at the given cursor (0 to start) in template order and advances the cursor
+    //returns 1 if a config value was filled in, 0 once all config values have been visited
+LCONDEF int lconfigIterateSection(const char*, int, int*, struct lconfig_info*);
+    //same as lconfigIterate, but only visits config values within the given section (length -1 if
+    //NUL terminated, e.g. "cache" visits "cache.size" and "cache.l1.size") in name order
+LCONDEF int lconfigReadSection(const char*, int);
+    //same as lconfigRead, but only applies config values within the given section (see above)
+#ifdef LCONFIG_DYNAMIC
+LCONDEF int lconfigRegisterInt(const char*, int, int, int);
+    //registers an integer config value with the given name, min, max and default at runtime
+    //returns its ID, the existing ID if the name was already registered as a dynamic int, -1 on failure
+LCONDEF int lconfigRegisterString(const char*, int, const char*);
+    //registers a string config value with the given name, maximum length and default at runtime
+    //returns its ID, the existing ID if the name was already registered as a dynamic string, -1 on failure
+#endif
+#ifdef LCONFIG_SPANS
+LCONDEF const char* lconfigGetStringSpan(int, int*);
+    //same as lconfigGetString, but also stores the length of the value (0 if there is no such ID)
+#endif
+#ifdef LCONFIG_OVERRIDE
+LCONDEF int lconfigPush();
+    //opens an override scope on the calling thread, returns 0 on success, -1 if the stack is full
+LCONDEF void lconfigPop();
+    //closes the innermost override scope on the calling thread, dropping its overrides
+LCONDEF int lconfigOverrideInt(int, int);
+    //overrides the integer config value with the given ID for the calling thread until the scope is closed
+    //returns 0 on success, -1 if no scope is open, the stack is full or there is no such ID
+LCONDEF int lconfigOverrideString(int, const char*);
+    //overrides the string config value with the given ID for the calling thread until the scope is closed
+    //returns 0 on success, -1 if no scope is open, the stack is full or there is no such ID
+#endif
+#ifdef LCONFIG_PROVENANCE
+#define LCONFIG_SDEF 0 //default value, never changed or reset by lconfigDefault
+#define LCONFIG_SFILE 1 //read from the config file
+#define LCONFIG_SSET 2 //set through lconfigSetInt/lconfigSetString or their ByName variants
+struct lconfig_source {
+    int source; //LCONFIG_SDEF, LCONFIG_SFILE or LCONFIG_SSET
+    int line; //line of the config file the value was read from, 0 unless LCONFIG_SFILE
+    int clamped; //1 if the value was clamped to MIN/MAX or truncated to LEN, 0 otherwise
+};
+LCONDEF int lconfigSource(int, int, struct lconfig_source*);
+    //fills in where the current value of the config value with the given type and ID came from
+    //returns 0 on success, -1 if there is no such int or string (maps are not tracked)
+#endif
+#ifdef LCONFIG_STATS
+struct lconfig_stats {
+    unsigned long long reads; //successful lconfigRead calls
+    unsigned long long writes; //successful lconfigWrite and lconfigPatch calls
+    unsigned long long lines; //lines parsed by lconfigRead
+    unsigned long long rbytes; //bytes read by lconfigRead
+    unsigned long long wbytes; //bytes written by lconfigWrite and lconfigPatch
+    unsigned long long unknown; //lines not matching any config value (blank and # lines excluded)
+    unsigned long long matched; //lines matching a config value
+    unsigned long long clamped; //int values clamped to MIN/MAX, by reads and sets
+    unsigned long long truncated; //string values truncated to LEN, by reads and sets
+    unsigned long long duplicate; //lines setting a config value already set earlier in the same read
+    unsigned long long invalid; //int values read with trailing garbage or without any digits
+    unsigned long long syncs; //fsync/fdatasync calls on the config file and its directory (LCONFIG_DURABLE)
+    unsigned long long tread, tparse, tapply, twrite, tsync; //cumulative nanoseconds spent in each phase
+    unsigned long long lread, lparse, lapply, lwrite, lsync; //nanoseconds spent in each phase by the last one
+};
+LCONDEF struct lconfig_stats lconfigStats();
+    //returns a snapshot of the runtime statistics (only available with LCONFIG_STATS)
+#endif
+#ifdef LCONFIG_PROFILE
+struct lconfig_prof {
+    int type; //LCONFIG_TINT or LCONFIG_TSTR
+    int id; //ID of the config value
+    const char* name; //name in config file, not NUL terminated at len
+    int len; //length of name
+    unsigned long long reads; //get calls, estimated from samples
+    unsigned long long writes; //set calls and values read from file
+};
+LCONDEF int lconfigProfile(struct lconfig_prof*, int);
+    //fills up to the given number of entries with config values ranked by reads, then writes
+    //returns the number of entries filled, keys never accessed come last (only with LCONFIG_PROFILE)
+LCONDEF void lconfigProfileReset();
+    //resets all access counters to zero (only available with LCONFIG_PROFILE)
+#endif
+#ifdef LCONFIG_TRACE
+struct lconfig_trace {
+    void* user; //passed as first argument to every hook, any hook may be NULL
+    void (*readBegin)(void*, const char*); //path of the config file
+    void (*readEnd)(void*, unsigned long long, unsigned long long); //bytes read, nanoseconds
+    void (*parseBegin)(void*, const char*); //line as read from the file
+    void (*parseEnd)(void*, unsigned long long, unsigned long long); //bytes in line, nanoseconds
+    void (*applyBegin)(void*, int, int); //type and ID of the matched config value
+    void (*applyEnd)(void*, int, int, unsigned long long); //type, ID, nanoseconds
+    void (*writeBegin)(void*, const char*); //path of the config file
+    void (*writeEnd)(void*, unsigned long long, unsigned long long); //bytes written, nanoseconds
+};
+LCONDEF void lconfigTrace(const struct lconfig_trace*);
+    //installs a copy of the given hooks, NULL removes them (only available with LCONFIG_TRACE)
+    //must not be called while another thread is inside lconfigRead or lconfigWrite
+#endif
+#ifdef LCONFIG_CAPTURE
+#define LCONFIG_CGETINT 1 //lconfigGetInt
+#define LCONFIG_CGETSTR 2 //lconfigGetString
+#define LCONFIG_CSETINT 3 //lconfigSetInt
+#define LCONFIG_CSETSTR 4 //lconfigSetString
+#define LCONFIG_CREAD 5 //lconfigRead
+#define LCONFIG_CWRITE 6 //lconfigWrite
+struct lconfig_rec {
+    unsigned long long ns; //nanoseconds since the capture started, taken when the call was made
+    unsigned thread; //calling thread, numbered from 0 in order of their first captured call
+    unsigned short op; //one of the LCONFIG_C* constants above
+    unsigned short len; //length of the string following the record for LCONFIG_CSETSTR, 0 otherwise
+    int id; //ID of the config value, -1 for reads and writes
+    int val; //value set for LCONFIG_CSETINT, 0 otherwise
+};
+LCONDEF int lconfigCapture(const char*);
+    //starts capturing calls into a new trace file at the given path, NULL stops and flushes the capture
+    //returns 0 on success, -1 if the file could not be created (only available with LCONFIG_CAPTURE)
+#endif
 
 #endif //LCONFIG_H
 
@@ -122,127 +541,2451 @@ LCONDEF void lconfigSetString(int, const char*);
 
 //includes
 #include <string.h> //string operations
-#include <stdlib.h> //atoi and others
+#include <stdlib.h> //malloc, qsort and others
 #include <stdio.h> //reading/writing config file
+#include <stdint.h> //fixed width name hash
+#include <limits.h> //saturating int parsing
+#if defined(LCONFIG_STATS)||defined(LCONFIG_TRACE)
+    #define LCFG_TIMED
+    #include <time.h> //timing instrumentation
+#endif
+#ifdef LCONFIG_CAPTURE
+    #include <time.h> //capture timestamps
+#endif
+#ifdef LCONFIG_SDT
+    #include <sys/sdt.h> //USDT probes
+#endif
+#ifdef LCONFIG_LOCK
+    #include <errno.h> //lock contention
+    #include <fcntl.h> //record locks
+    #include <time.h> //lock backoff
+    #include <unistd.h> //truncating before writes
+#endif
+#ifdef LCONFIG_PARALLEL
+    #include <pthread.h> //chunked reading
+#endif
+#ifdef LCONFIG_NUMA
+    #include <pthread.h> //replica updates
+    #include <sys/mman.h> //node local replicas
+    #include <sys/syscall.h> //getcpu
+    #include <unistd.h> //syscall
+    #ifndef MAP_ANONYMOUS
+        #error "LCONFIG_NUMA needs _GNU_SOURCE or _DEFAULT_SOURCE defined before any include"
+    #endif
+#endif
+#ifdef LCONFIG_PRELOAD
+    #include <pthread.h> //preload thread
+#endif
+#ifdef LCONFIG_LAZY
+    #include <pthread.h> //decoding on first use
+#endif
+#ifdef LCONFIG_DURABLE
+    #include <fcntl.h> //opening directories
+    #include <unistd.h> //fsync, fdatasync
+    #include <sys/stat.h> //detecting replaced config files
+#endif
+#ifdef LCONFIG_PATCH
+    #include <time.h> //modification times
+    #include <sys/stat.h> //detecting changed config files
+#endif
 
 //structs
+#ifdef LCONFIG_PATCH
+struct lcfg_loc {
+    long pos; //offset of the value in the config file + 1, 0 if not in it
+    int len; //length of the value in the config file
+    uint32_t hash; //hash of the value in the config file
+};
+#endif
 struct lcfg_int {
     const char* const name; //name in config file
     const int min; //min value
     const int max; //max value
     const int def; //default value
     int cur; //current value
+    #ifdef LCONFIG_STATS
+    unsigned gen; //read generation in which this was last read, to detect duplicates
+    #endif
+    #ifdef LCONFIG_PATCH
+    struct lcfg_loc loc; //where the value is in the config file
+    #endif
+    #ifdef LCONFIG_PROFILE
+    unsigned long long reads, writes; //access counters
+    #endif
 };
 struct lcfg_str {
     const char* const name; //name in config file
     const int len; //maximum length
     const char* const def; //default value
     char* const cur; //current value
+    #ifdef LCONFIG_SPANS
+    const char* span; //current value if not NULL, NUL terminated span into lcfg_buf
+    size_t slen; //length of span
+    #endif
+    #ifdef LCONFIG_STATS
+    unsigned gen; //read generation in which this was last read, to detect duplicates
+    #endif
+    #ifdef LCONFIG_PATCH
+    struct lcfg_loc loc; //where the value is in the config file
+    #endif
+    #ifdef LCONFIG_PROFILE
+    unsigned long long reads, writes; //access counters
+    #endif
+};
+struct lcfg_ent {
+    uint32_t hash; //hash of the key
+    int off; //offset of the key in the key storage of its map
+    int len; //length of the key
+    int val; //current value
+};
+struct lcfg_map {
+    const char* const name; //name in config file, followed by a space
+    const int num; //maximum number of entries
+    const int min; //minimum value
+    const int max; //maximum value
+    const int def; //value of keys not in the map
+    struct lcfg_ent* ents; //entries in order of insertion, NULL until first used
+    int* slots; //open addressing table of entry indices + 1, a power of two at least twice num
+    char* keys; //key storage, keys are not NUL terminated
+    int cnt, cap; //entries in use, number of slots
+    size_t klen, kcap; //used and allocated key storage
+};
+struct lcfg_key {
+    int type; //LCFG_INT or LCFG_STR, 0 for an empty slot
+    int id; //index into lcfg_ints or lcfg_strs
+    int len; //length of name including trailing space
 };
+struct lcfg_lay {
+    const char* const pre; //literal text written before the value, ending with the name (tables only)
+    const int type; //LCFG_INT or LCFG_STR, 0 for the trailing text
+    const int id; //index into lcfg_ints or lcfg_strs
+};
+#define LCFG_INT LCONFIG_TINT
+#define LCFG_STR LCONFIG_TSTR
+#define LCFG_MAP LCONFIG_TMAP
+#if defined(__GNUC__)||defined(__clang__)
+    #define LCFG_TLS __thread
+#elif defined(_MSC_VER)
+    #define LCFG_TLS __declspec(thread)
+#elif __STDC_VERSION__ >= 201112L
+    #define LCFG_TLS _Thread_local
+#else
+    #define LCFG_TLS //no thread-local storage, shared instead
+#endif
+#if (defined(__BYTE_ORDER__)&&(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__))||defined(_MSC_VER)
+    #define LCFG_SWAR //digits are converted several at a time, which relies on the byte order
+#endif
 
 //function declarations
-static void lcfgIntRead(struct lcfg_int*, const char*);
-static void lcfgStrRead(struct lcfg_str*, const char*);
+#if !defined(LCONFIG_TABLES)||defined(LCONFIG_DYNAMIC)
 static void lcfgIntPrint(struct lcfg_int*, FILE*);
 static void lcfgStrPrint(struct lcfg_str*, FILE*);
-static void lcfgIntSet(struct lcfg_int*, int);
-static void lcfgStrSet(struct lcfg_str*, const char*);
+#endif
+static void lcfgMapPrint(struct lcfg_map*, const char*, FILE*);
+static struct lcfg_int* lcfgInt(int);
+static struct lcfg_str* lcfgStr(int);
+static struct lcfg_map* lcfgMap(int);
+static const char* lcfgName(int, int);
+static int lcfgWithin(const char*, const char*, size_t);
+static int lcfgMapFind(const struct lcfg_map*, const char*, size_t);
+static int lcfgMapSet(struct lcfg_map*, const char*, size_t, int);
+static void lcfgMapClear(struct lcfg_map*);
+static int lcfgIntSet(struct lcfg_int*, int);
+static int lcfgParse(const char*, int*);
+#ifdef LCFG_SWAR
+static uint32_t lcfgDigits4(const char*);
+static uint32_t lcfgDigits8(const char*);
+#endif
+static int lcfgStrSet(struct lcfg_str*, const char*);
+static const char* lcfgStrCur(const struct lcfg_str*);
+#ifdef LCONFIG_SPANS
+static int lcfgStrSpan(struct lcfg_str*, char*);
+#endif
+#if defined(LCONFIG_SPANS)||defined(LCONFIG_PATCH)||defined(LCONFIG_PARALLEL)||defined(LCONFIG_LAZY)
+static char* lcfgSlurp(FILE*, size_t*);
+#endif
+#ifdef LCONFIG_PATCH
+struct lcfg_patch;
+static int lcfgPatch(int);
+static int lcfgPatchFile(int, long*);
+static void lcfgLocate(int, int, long, const char*);
+static size_t lcfgLocated(int, int, const char*, int);
+static const char* lcfgText(int, int, char*, int*);
+static int lcfgPatchCompare(const void*, const void*);
+static long lcfgMtime(const struct stat*);
+static void lcfgStamp(const struct stat*);
+static int lcfgStale(const struct stat*);
+static int lcfgVerify(FILE*, struct lcfg_patch*, int);
+static int lcfgSame(int);
+#endif
+struct lcfg_read;
+static int lcfgRead(const char*, size_t, int, int);
+static int lcfgWrite(int, int);
+static void lcfgSparse(FILE*, int);
+#ifdef LCONFIG_LOCK
+static int lcfgLock(int, int, int);
+#endif
+#ifdef LCONFIG_PRELOAD
+static void* lcfgPreload(void*);
+static void lcfgPreloading(int);
+#endif
+#ifdef LCONFIG_DURABLE
+static FILE* lcfgCreate(int, int, int*, int*);
+static int lcfgCommit(FILE*, int, int, int);
+static int lcfgSyncFile(int, int);
+static int lcfgSyncDir();
+#ifdef LCONFIG_STATS
+static void lcfgSyncStat(unsigned long long);
+#endif
+#endif
+static void lcfgLine(const char*, struct lcfg_read*);
+static void lcfgApply(int, int, const char*, int);
+#ifdef LCONFIG_LAZY
+static int lcfgDefer(int, int, const char*, size_t, int);
+static uint32_t lcfgPending(int, int);
+static void lcfgDecode(int, int);
+static void lcfgDecodeAll();
+static void lcfgUnpend(int, int);
+#endif
+static int lcfgSection(const char*, char*, size_t*);
+static const char* lcfgResolve(const char*, char*, size_t, int*, int*);
+#ifdef LCONFIG_PARALLEL
+struct lcfg_chunk;
+static int lcfgParallel(char*, size_t, struct lcfg_read*);
+static void* lcfgChunk(void*);
+#endif
+static void lcfgInfo(int, int, struct lconfig_info*);
+static int lcfgSorted();
+static int lcfgNameCompare(const void*, const void*);
+static const char* lcfgFind(const char*, int*, int*);
+static const struct lcfg_key* lcfgKey(const char*, size_t, int);
+static int lcfgMatch(const struct lcfg_key*, const char*, size_t, int);
+static uint32_t lcfgHash(const char*, size_t, uint32_t);
+#ifndef LCONFIG_TABLES
+static void lcfgIndex();
+#endif
+#if defined(LCFG_TIMED)||defined(LCONFIG_CAPTURE)
+static unsigned long long lcfgNanos();
+#endif
+#if defined(LCONFIG_STATS)||defined(LCONFIG_PROFILE)
+static void lcfgStatAdd(unsigned long long*, unsigned long long);
+#endif
+#ifdef LCONFIG_PROFILE
+static int lcfgProfCompare(const void*, const void*);
+#endif
+#ifdef LCONFIG_DYNAMIC
+static int lcfgRegister(int, const char*, const void*);
+#endif
+#ifdef LCONFIG_PROVENANCE
+static uint32_t* lcfgProv(int, int);
+#endif
+#ifdef LCONFIG_CAPTURE
+struct lcfg_cap;
+static void lcfgCapture(int, int, int, const char*);
+static void lcfgCaptureFlush(struct lcfg_cap*);
+#endif
+#ifdef LCONFIG_NUMA
+static const int* lcfgReplica();
+static void lcfgReplicaSet(struct lcfg_int*, int);
+#ifdef LCONFIG_TABLES
+static void lcfgReplicaSync();
+#endif
+#endif
+#ifdef LCONFIG_OVERRIDE
+static struct lcfg_ovr* lcfgOverride(int, int);
+static struct lcfg_ovr* lcfgOverridePush(int, int);
+#endif
 
 //internal globals
+struct lcfg_tok {
+    char* txt; //start of the line, not NUL terminated until it is applied
+    const char* val; //value as found by lcfgResolve
+    size_t len; //length of the line without newline
+    int type, id; //config value as found by lcfgResolve, type -1 if the line still has to be looked up
+};
+struct lcfg_read {
+    char sec[LCONFIG_LMAX]; //current section followed by a dot, empty at the top level
+    size_t slen; //length of sec
+    const char* sub; //section whose config values are applied, NULL to apply all
+    size_t sublen; //length of sub
+    int apply; //0 to only locate values (for lconfigPatch)
+    long pos; //offset of the current line in the file
+    int line; //number of the current line, starting at 1
+    const struct lcfg_tok* tok; //current line as resolved by lcfgParallel, NULL if none
+};
+#ifdef LCONFIG_TABLES
+#include LCONFIG_TABLES
+#else
 #define LCONFIG_LINE(...)
 #define LCONFIG_INT(ID, NAME, MIN, MAX, DEF) [ID] = {NAME " ", MIN, MAX, DEF, DEF},
 #define LCONFIG_STR(ID, NAME, LEN, DEF)
+#define LCONFIG_MAP(ID, NAME, NUM, MIN, MAX, DEF)
 static struct lcfg_int lcfg_ints[] = {{0}, LCONFIG_TEMPLATE};
 #undef LCONFIG_INT
 #undef LCONFIG_STR
 #define LCONFIG_INT(ID, NAME, MIN, MAX, DEF)
 #define LCONFIG_STR(ID, NAME, LEN, DEF) [ID] = {NAME " ", LEN, DEF, (char[LEN+1]){DEF}},
 static struct lcfg_str lcfg_strs[] = {{0}, LCONFIG_TEMPLATE};
+#undef LCONFIG_STR
+#undef LCONFIG_MAP
+#define LCONFIG_STR(ID, NAME, LEN, DEF)
+#define LCONFIG_MAP(ID, NAME, NUM, MIN, MAX, DEF) [ID] = {NAME " ", NUM, MIN, MAX, DEF},
+static struct lcfg_map lcfg_maps[] = {{0}, LCONFIG_TEMPLATE};
+#undef LCONFIG_INT
+#undef LCONFIG_STR
+#undef LCONFIG_MAP
+#define LCONFIG_INT(ID, NAME, MIN, MAX, DEF) {NULL, LCFG_INT, ID},
+#define LCONFIG_STR(ID, NAME, LEN, DEF) {NULL, LCFG_STR, ID},
+#define LCONFIG_MAP(ID, NAME, NUM, MIN, MAX, DEF) {NULL, LCFG_MAP, ID},
+static const struct lcfg_lay lcfg_lays[] = {LCONFIG_TEMPLATE {NULL, 0, 0}}; //template order
 #undef LCONFIG_LINE
 #undef LCONFIG_INT
 #undef LCONFIG_STR
+#undef LCONFIG_MAP
+#endif
+#define LCFG_NLAYS ((int)(sizeof(lcfg_lays)/sizeof(lcfg_lays[0])))
+#define LCFG_NINTS ((int)(sizeof(lcfg_ints)/sizeof(lcfg_ints[0])))
+#define LCFG_NSTRS ((int)(sizeof(lcfg_strs)/sizeof(lcfg_strs[0])))
+#define LCFG_NMAPS ((int)(sizeof(lcfg_maps)/sizeof(lcfg_maps[0])))
+#ifndef LCONFIG_TABLES
+static struct lcfg_key lcfg_keys[2*(LCFG_NINTS + LCFG_NSTRS + LCFG_NMAPS) + 1]; //name index, built lazily
+static int lcfg_indexed; //1 once lcfg_keys is built, 2 if some name contains a space
+#endif
+#if defined(LCONFIG_SPANS)||defined(LCONFIG_LAZY)
+static char* lcfg_buf; //config file as of the last read, string spans and pending values point into it
+static size_t lcfg_buflen; //size of lcfg_buf
+#endif
+#ifdef LCONFIG_LAZY
+static uint32_t lcfg_lazy_ints[LCFG_NINTS]; //offset + 1 in lcfg_buf of each template int still to be decoded
+static uint32_t lcfg_lazy_strs[LCFG_NSTRS]; //same for each template str, 0 once decoded
+static pthread_mutex_t lcfg_lazy_lock = PTHREAD_MUTEX_INITIALIZER; //held while decoding and reading
+static LCFG_TLS int lcfg_lazy_held; //1 while this thread reads, so its trace hooks do not wait for themselves
+#define LCFG_DECODE(T, I) if (lcfgPending(T, I)) lcfgDecode(T, I);
+#else
+#define LCFG_DECODE(T, I)
+#endif
+#ifdef LCONFIG_LOCK
+static int lcfg_wait = LCONFIG_LOCK; //lock timeout in milliseconds, -1 waits forever
+#endif
+#ifdef LCONFIG_DURABLE
+static int lcfg_durable = LCONFIG_DURABLE; //durability level of writes
+static int lcfg_sync_fd = -1; //descriptor of the config file lconfigSync flushes through, kept open
+#endif
+#ifdef LCONFIG_PRELOAD
+static int lcfg_preload; //1 while a preload is running, stored under lcfg_preload_lock
+static int lcfg_preload_err; //result of the last preload
+static pthread_mutex_t lcfg_preload_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t lcfg_preload_done = PTHREAD_COND_INITIALIZER; //signalled when a preload ends
+static LCFG_TLS int lcfg_preloader; //1 on the preload thread, which must not wait for itself
+#if defined(__GNUC__)||defined(__clang__) //acquire, so values read by the preload are visible once it is done
+#define LCFG_READY if (__atomic_load_n(&lcfg_preload, __ATOMIC_ACQUIRE)) lconfigPreloadWait();
+#else
+#define LCFG_READY if (lcfg_preload) lconfigPreloadWait();
+#endif
+#else
+#define LCFG_READY
+#endif
+#ifdef LCONFIG_PATCH
+static long lcfg_fsize = -1; //size of the config file when offsets were taken, -1 if they are unknown
+static time_t lcfg_ftime; //modification time of the config file when offsets were taken
+static long lcfg_fnsec; //nanoseconds of lcfg_ftime, 0 where the platform does not report them
+static int lcfg_fsec; //1 if the config file ends inside a section, so appended names need a "[]" first
+#endif
+static struct lcfg_key* lcfg_sorted; //all config values sorted by name, built on first use
+static int lcfg_nsorted; //entries in lcfg_sorted, rebuilt whenever it differs from lconfigCount()
+#ifdef LCONFIG_STATS
+static struct lconfig_stats lcfg_stats; //cumulative, only updated through lcfgStatAdd
+static struct lconfig_stats lcfg_pass; //counters of the read in progress, added to lcfg_stats when done
+static unsigned lcfg_gen; //read generation, used to detect duplicate keys
+#define LCFG_STAT(F, N) lcfgStatAdd(&lcfg_stats.F, N);
+#else
+#define LCFG_STAT(F, N)
+#endif
+#ifdef LCFG_TIMED
+#define LCFG_CLOCK(T) unsigned long long T = lcfgNanos();
+#else
+#define LCFG_CLOCK(T)
+#endif
+#ifdef LCONFIG_TRACE
+static struct lconfig_trace lcfg_trace; //installed hooks, all NULL by default
+#define LCFG_HOOK(F, ...) if (lcfg_trace.F) lcfg_trace.F(lcfg_trace.user, __VA_ARGS__);
+#else
+#define LCFG_HOOK(F, ...)
+#endif
+#ifdef LCONFIG_SDT
+#define LCFG_PROBE1(N, A) DTRACE_PROBE1(lconfig, N, A);
+#define LCFG_PROBE2(N, A, B) DTRACE_PROBE2(lconfig, N, A, B);
+#define LCFG_PROBE3(N, A, B, C) DTRACE_PROBE3(lconfig, N, A, B, C);
+#else
+#define LCFG_PROBE1(N, A)
+#define LCFG_PROBE2(N, A, B)
+#define LCFG_PROBE3(N, A, B, C)
+#endif
+#ifdef LCONFIG_PROFILE
+static LCFG_TLS unsigned lcfg_tick; //per-thread sampling counter
+#define LCFG_READ(P) if (!(++lcfg_tick&(LCONFIG_PROFILE - 1))) lcfgStatAdd(&(P)->reads, LCONFIG_PROFILE);
+#define LCFG_WRITE(P) lcfgStatAdd(&(P)->writes, 1);
+#else
+#define LCFG_READ(P)
+#define LCFG_WRITE(P)
+#endif
+#ifdef LCONFIG_DYNAMIC
+static struct lcfg_int* lcfg_dyn_ints; //registered ints, IDs start at LCFG_NINTS
+static struct lcfg_str* lcfg_dyn_strs; //registered strs, IDs start at LCFG_NSTRS
+static struct lcfg_key* lcfg_dyn_lays; //registered config values in order of registration (len unused)
+static struct lcfg_key* lcfg_dyn_keys; //name index of registered config values, power of two sized
+static int lcfg_dyn_nints, lcfg_dyn_nstrs, lcfg_dyn_nlays, lcfg_dyn_cap, lcfg_dyn_kcap;
+#define LCFG_ALLINTS (LCFG_NINTS + lcfg_dyn_nints)
+#define LCFG_ALLSTRS (LCFG_NSTRS + lcfg_dyn_nstrs)
+#else
+#define LCFG_ALLINTS LCFG_NINTS
+#define LCFG_ALLSTRS LCFG_NSTRS
+#endif
+#ifdef LCONFIG_PROVENANCE
+static uint32_t lcfg_prov_ints[LCFG_NINTS]; //source | clamped << 2 | line << 3 of each template int
+static uint32_t lcfg_prov_strs[LCFG_NSTRS]; //same for each template str
+#ifdef LCONFIG_DYNAMIC
+static uint32_t* lcfg_dyn_pints; //same for registered ints, grown along with lcfg_dyn_ints
+static uint32_t* lcfg_dyn_pstrs; //same for registered strs
+#endif
+#define LCFG_PROV(T, I, S, L, C) *lcfgProv(T, I) = (S)|((C) ? 4 : 0)|((uint32_t)(L) << 3);
+#else
+#define LCFG_PROV(T, I, S, L, C) (void)(C);
+#endif
+#ifdef LCONFIG_CAPTURE
+struct lcfg_cap {
+    char buf[8192]; //records not yet written to the trace file
+    size_t len; //bytes used in buf
+    unsigned thread; //number of the owning thread
+    struct lcfg_cap* next; //next buffer in lcfg_caps
+};
+static FILE* lcfg_capf; //trace file while capturing, NULL otherwise
+static unsigned long long lcfg_capt; //lcfgNanos at the start of the capture
+static struct lcfg_cap* lcfg_caps; //buffers of all threads that ever captured a call, never freed
+static unsigned lcfg_capn; //number of buffers in lcfg_caps
+static LCFG_TLS struct lcfg_cap* lcfg_cap; //buffer of this thread, NULL until its first captured call
+#define LCFG_CAPTURE(OP, ID, VAL, STR) if (lcfg_capf) lcfgCapture(OP, ID, VAL, STR);
+#else
+#define LCFG_CAPTURE(OP, ID, VAL, STR)
+#endif
+#ifdef LCONFIG_NUMA
+static int* lcfg_numa[LCONFIG_NUMA]; //replica of the template ints of each node, NULL until first used
+static pthread_mutex_t lcfg_numa_lock = PTHREAD_MUTEX_INITIALIZER; //guards lcfg_numa and int stores
+static LCFG_TLS const int* lcfg_replica; //replica read by this thread, NULL until its first get
+static LCFG_TLS int lcfg_noreplica; //1 if no replica could be made, the thread reads lcfg_ints instead
+#endif
+#ifdef LCONFIG_OVERRIDE
+struct lcfg_ovr {
+    int type; //LCFG_INT or LCFG_STR, 0 marks the start of a scope
+    int id; //ID of the overridden config value
+    int val; //int override
+    char* str; //str override, owned by the entry
+};
+static LCFG_TLS struct lcfg_ovr lcfg_ovrs[LCONFIG_OVERRIDE]; //per-thread stack of scopes and overrides
+static LCFG_TLS int lcfg_novrs; //entries on the stack, 0 while no scope is active
+#endif
 
 //public functions
 LCONDEF void lconfigDefault () {
-    for (int i = 0; i < sizeof(lcfg_ints)/sizeof(lcfg_ints[0]); i++)
+    LCFG_READY
+    #ifdef LCONFIG_TABLES //defaults were clamped by lcfggen, so they can be copied as-is
+    for (int i = 0; i < LCFG_NINTS; i++)
+        lcfg_ints[i].cur = lcfg_ints[i].def;
+    for (int i = 0; i < LCFG_NSTRS; i++)
+        if (lcfg_strs[i].name) strcpy(lcfg_strs[i].cur, lcfg_strs[i].def);
+    #ifdef LCONFIG_NUMA
+    lcfgReplicaSync();
+    #endif
+    #else
+    for (int i = 0; i < LCFG_NINTS; i++)
         if (lcfg_ints[i].name) lcfgIntSet(&lcfg_ints[i], lcfg_ints[i].def);
-    for (int i = 0; i < sizeof(lcfg_strs)/sizeof(lcfg_strs[0]); i++)
+    for (int i = 0; i < LCFG_NSTRS; i++)
         if (lcfg_strs[i].name) lcfgStrSet(&lcfg_strs[i], lcfg_strs[i].def);
+    #endif
+    for (int i = 0; i < LCFG_NMAPS; i++) lcfgMapClear(&lcfg_maps[i]);
+    #ifdef LCONFIG_DYNAMIC
+    for (int i = 0; i < lcfg_dyn_nints; i++) lcfg_dyn_ints[i].cur = lcfg_dyn_ints[i].def;
+    for (int i = 0; i < lcfg_dyn_nstrs; i++) strcpy(lcfg_dyn_strs[i].cur, lcfg_dyn_strs[i].def);
+    #endif
+    #ifdef LCONFIG_SPANS
+    for (int i = 0; i < LCFG_ALLSTRS; i++) if (lcfgStr(i)) lcfgStr(i)->span = NULL; //defaults are in cur
+    #endif
+    #ifdef LCONFIG_LAZY
+    memset(lcfg_lazy_ints, 0, sizeof(lcfg_lazy_ints));
+    memset(lcfg_lazy_strs, 0, sizeof(lcfg_lazy_strs));
+    #endif
+    #ifdef LCONFIG_PROVENANCE
+    memset(lcfg_prov_ints, 0, sizeof(lcfg_prov_ints));
+    memset(lcfg_prov_strs, 0, sizeof(lcfg_prov_strs));
+    #ifdef LCONFIG_DYNAMIC
+    if (lcfg_dyn_nints) memset(lcfg_dyn_pints, 0, lcfg_dyn_nints*sizeof(uint32_t));
+    if (lcfg_dyn_nstrs) memset(lcfg_dyn_pstrs, 0, lcfg_dyn_nstrs*sizeof(uint32_t));
+    #endif
+    #endif
 }
 LCONDEF int lconfigRead () {
-    FILE* cfg = fopen(LCONFIG_PATH, "r");
-    if (cfg) {
-        char txt[LCONFIG_LMAX];
-        while (fgets(txt, LCONFIG_LMAX, cfg)) {
-            for (int i = 0; i < sizeof(lcfg_ints)/sizeof(lcfg_ints[0]); i++)
-                if (lcfg_ints[i].name) lcfgIntRead(&lcfg_ints[i], txt);
-            for (int i = 0; i < sizeof(lcfg_strs)/sizeof(lcfg_strs[0]); i++)
-                if (lcfg_strs[i].name) lcfgStrRead(&lcfg_strs[i], txt);
-        }
-        fclose(cfg);
+    LCFG_READY
+    LCFG_CAPTURE(LCONFIG_CREAD, -1, 0, NULL)
+    #ifdef LCONFIG_LOCK
+    return lcfgRead(NULL, 0, lcfg_wait, 1);
+    #else
+    return lcfgRead(NULL, 0, -1, 1);
+    #endif
+}
+LCONDEF int lconfigWrite () {
+    LCFG_READY
+    LCFG_CAPTURE(LCONFIG_CWRITE, -1, 0, NULL)
+    #ifdef LCONFIG_LOCK
+    return lcfgWrite(lcfg_wait, -1);
+    #else
+    return lcfgWrite(-1, -1);
+    #endif
+}
+LCONDEF int lconfigWriteSparse (int sections) {
+    LCFG_READY
+    LCFG_CAPTURE(LCONFIG_CWRITE, -1, 0, NULL)
+    #ifdef LCONFIG_LOCK
+    return lcfgWrite(lcfg_wait, sections ? 1 : 0);
+    #else
+    return lcfgWrite(-1, sections ? 1 : 0);
+    #endif
+}
+LCONDEF int lconfigReadSection (const char* section, int len) {
+    LCFG_READY
+    LCFG_CAPTURE(LCONFIG_CREAD, -1, 0, NULL)
+    #ifdef LCONFIG_LOCK
+    return lcfgRead(section, (len < 0) ? strlen(section) : (size_t)len, lcfg_wait, 1);
+    #else
+    return lcfgRead(section, (len < 0) ? strlen(section) : (size_t)len, -1, 1);
+    #endif
+}
+#ifdef LCONFIG_PATCH
+LCONDEF int lconfigPatch () {
+    LCFG_READY
+    LCFG_CAPTURE(LCONFIG_CWRITE, -1, 0, NULL)
+    #ifdef LCONFIG_LOCK
+    return lcfgPatch(lcfg_wait);
+    #else
+    return lcfgPatch(-1);
+    #endif
+}
+#endif
+#ifdef LCONFIG_LOCK
+LCONDEF int lconfigTryRead () {
+    LCFG_READY
+    LCFG_CAPTURE(LCONFIG_CREAD, -1, 0, NULL)
+    return lcfgRead(NULL, 0, 0, 1);
+}
+LCONDEF int lconfigTryWrite () {
+    LCFG_READY
+    LCFG_CAPTURE(LCONFIG_CWRITE, -1, 0, NULL)
+    return lcfgWrite(0, -1);
+}
+LCONDEF void lconfigLockTimeout (int ms) {
+    lcfg_wait = (ms < 0) ? -1 : ms;
+}
+#endif
+#ifdef LCONFIG_PRELOAD
+LCONDEF int lconfigPreloadAsync () {
+    pthread_mutex_lock(&lcfg_preload_lock);
+    if (lcfg_preload) {
+        pthread_mutex_unlock(&lcfg_preload_lock);
+        return -1;
+    }
+    pthread_t thr;
+    lcfgPreloading(1);
+    if (pthread_create(&thr, NULL, lcfgPreload, NULL) == 0) {
+        pthread_detach(thr);
+        pthread_mutex_unlock(&lcfg_preload_lock);
         return 0;
     }
-    return 1;
+    lcfgPreloading(0); //no thread available, read right here
+    pthread_mutex_unlock(&lcfg_preload_lock);
+    int err = lconfigRead();
+    pthread_mutex_lock(&lcfg_preload_lock);
+    lcfg_preload_err = err;
+    pthread_mutex_unlock(&lcfg_preload_lock);
+    return 0;
+}
+LCONDEF int lconfigPreloadWait () {
+    if (lcfg_preloader) return 0; //called on the preload thread, e.g. from a trace hook
+    pthread_mutex_lock(&lcfg_preload_lock);
+    while (lcfg_preload) pthread_cond_wait(&lcfg_preload_done, &lcfg_preload_lock);
+    int err = lcfg_preload_err;
+    pthread_mutex_unlock(&lcfg_preload_lock);
+    return err;
+}
+#endif
+#ifdef LCONFIG_DURABLE
+LCONDEF int lconfigDurability (int level) {
+    if ((level < LCONFIG_DNONE)||(level > LCONFIG_DFULL)) return -1;
+    int prev = lcfg_durable;
+    lcfg_durable = level;
+    return prev;
 }
+LCONDEF int lconfigSync () {
+    //fsync flushes the file no matter which descriptor wrote it, but closing a descriptor drops all locks
+    //of the process on the file where fcntl locks are per process, so it is only closed once replaced
+    struct stat a, b;
+    if ((lcfg_sync_fd >= 0)&&((fstat(lcfg_sync_fd, &a))||(stat(LCONFIG_PATH, &b))||(a.st_dev != b.st_dev)||
+        (a.st_ino != b.st_ino))) {
+        close(lcfg_sync_fd); //renamed over, locks on the old file no longer protect anything
+        lcfg_sync_fd = -1;
+    }
+    if (lcfg_sync_fd < 0) lcfg_sync_fd = open(LCONFIG_PATH, O_RDONLY);
+    if (lcfg_sync_fd < 0) return 1;
+    int err = lcfgSyncFile(lcfg_sync_fd, LCONFIG_DFULL);
+    if (!err) err = lcfgSyncDir();
+    return err;
+}
+#endif
 #define LCONFIG_LINE(...) fprintf(cfg, __VA_ARGS__ "\n");
 #define LCONFIG_INT(ID, NAME, MIN, MAX, DEF) lcfgIntPrint(&lcfg_ints[ID], cfg);
 #define LCONFIG_STR(ID, NAME, LEN, DEF) lcfgStrPrint(&lcfg_strs[ID], cfg);
-LCONDEF int lconfigWrite () {
+#define LCONFIG_MAP(ID, NAME, NUM, MIN, MAX, DEF) lcfgMapPrint(&lcfg_maps[ID], lcfg_maps[ID].name, cfg);
+static int lcfgWrite (int ms, int sparse) {
+    //writes the config file, waiting up to ms milliseconds for the lock if locking
+    //sparse is -1 for the full layout, otherwise the sections argument of lconfigWriteSparse
+    int err = 1;
+    LCFG_CLOCK(beg)
+    LCFG_HOOK(writeBegin, LCONFIG_PATH)
+    LCFG_PROBE1(write_begin, LCONFIG_PATH)
+    #ifdef LCONFIG_LAZY
+    lcfgDecodeAll(); //everything written has to be decoded
+    #endif
+    #ifdef LCONFIG_DURABLE
+    int level = lcfg_durable, lock = -1;
+    FILE* cfg = lcfgCreate(ms, level, &lock, &err);
+    #elif defined(LCONFIG_LOCK) //lock before truncating, so readers never see a partial file
+    FILE* cfg = NULL;
+    int fd = open(LCONFIG_PATH, O_WRONLY|O_CREAT, 0666);
+    if (fd >= 0) {
+        if (lcfgLock(fd, 1, ms)) err = 2;
+        else if ((ftruncate(fd, 0) == 0)&&((cfg = fdopen(fd, "w")))) fd = -1; //now owned by cfg
+        if (fd >= 0) close(fd);
+    }
+    #else
     FILE* cfg = fopen(LCONFIG_PATH, "w");
+    (void)ms;
+    #endif
     if (cfg) {
-        LCONFIG_TEMPLATE;
+        #ifdef LCONFIG_PATCH
+        lcfg_fsize = -1; //offsets are stale once the file is rewritten
+        #endif
+        if (sparse >= 0) {
+            lcfgSparse(cfg, sparse);
+        } else {
+            #ifdef LCONFIG_TABLES
+            for (int i = 0; i < LCFG_NLAYS; i++) {
+                const struct lcfg_lay* lay = &lcfg_lays[i];
+                fputs(lay->pre, cfg); //pre-rendered lines and name (maps print their own names)
+                if (lay->type == LCFG_INT) fprintf(cfg, "%d\n", lcfg_ints[lay->id].cur);
+                else if (lay->type == LCFG_STR) fprintf(cfg, "%s\n", lcfgStrCur(&lcfg_strs[lay->id]));
+                else if (lay->type == LCFG_MAP)
+                    lcfgMapPrint(&lcfg_maps[lay->id], lcfg_maps[lay->id].name, cfg);
+            }
+            #else
+            LCONFIG_TEMPLATE;
+            #endif
+            #ifdef LCONFIG_DYNAMIC
+            for (int i = 0; i < lcfg_dyn_nlays; i++) {
+                if (lcfg_dyn_lays[i].type == LCFG_INT) lcfgIntPrint(lcfgInt(lcfg_dyn_lays[i].id), cfg);
+                else lcfgStrPrint(lcfgStr(lcfg_dyn_lays[i].id), cfg);
+            }
+            #endif
+        }
+        #ifdef LCFG_TIMED
+        long len = ftell(cfg);
+        if (len < 0) len = 0;
+        #endif
+        #ifdef LCONFIG_DURABLE
+        int done = !lcfgCommit(cfg, level, lock, level == LCONFIG_DFULL); //not on disk means it failed
+        #else
+        int done = 1;
         fclose(cfg);
-        return 0;
+        #endif
+        if (done) {
+            LCFG_CLOCK(end)
+            LCFG_HOOK(writeEnd, len, end - beg)
+            LCFG_PROBE2(write_end, len, end - beg)
+            #ifdef LCONFIG_STATS
+            lcfg_stats.lwrite = end - beg;
+            lcfgStatAdd(&lcfg_stats.twrite, lcfg_stats.lwrite);
+            lcfgStatAdd(&lcfg_stats.wbytes, len);
+            lcfgStatAdd(&lcfg_stats.writes, 1);
+            #endif
+            return 0;
+        }
     }
-    return 1;
+    #ifdef LCONFIG_TRACE
+    LCFG_CLOCK(end)
+    LCFG_HOOK(writeEnd, 0, end - beg)
+    LCFG_PROBE2(write_end, 0, end - beg)
+    #endif
+    return err;
 }
 #undef LCONFIG_LINE
 #undef LCONFIG_INT
 #undef LCONFIG_STR
+#undef LCONFIG_MAP
 LCONDEF int lconfigGetInt (int id) {
-    if ((id >= 0)&&(id < sizeof(lcfg_ints)/sizeof(lcfg_ints[0]))&&(lcfg_ints[id].name))
-        return lcfg_ints[id].cur;
+    LCFG_READY
+    LCFG_CAPTURE(LCONFIG_CGETINT, id, 0, NULL)
+    struct lcfg_int* cfg = lcfgInt(id);
+    if (cfg) {
+        LCFG_READ(cfg)
+        #ifdef LCONFIG_OVERRIDE
+        struct lcfg_ovr* ovr = lcfg_novrs ? lcfgOverride(LCFG_INT, id) : NULL;
+        if (ovr) return ovr->val;
+        #endif
+        LCFG_DECODE(LCFG_INT, id)
+        #ifdef LCONFIG_NUMA
+        const int* rep = lcfg_replica ? lcfg_replica : lcfg_noreplica ? NULL : lcfgReplica();
+        if ((rep)&&(id < LCFG_NINTS)) return rep[id];
+        #endif
+        return cfg->cur;
+    }
     return -1;
 }
 LCONDEF void lconfigSetInt (int id, int val) {
-    if ((id >= 0)&&(id < sizeof(lcfg_ints)/sizeof(lcfg_ints[0]))&&(lcfg_ints[id].name))
-        lcfgIntSet(&lcfg_ints[id], val);
+    LCFG_READY
+    LCFG_CAPTURE(LCONFIG_CSETINT, id, val, NULL)
+    struct lcfg_int* cfg = lcfgInt(id);
+    if (cfg) {
+        LCFG_DECODE(LCFG_INT, id) //or a later get would decode the value from the file over this one
+        LCFG_WRITE(cfg)
+        int clamped = lcfgIntSet(cfg, val);
+        LCFG_PROV(LCFG_INT, id, LCONFIG_SSET, 0, clamped)
+    }
 }
 LCONDEF const char* lconfigGetString (int id) {
-    if ((id >= 0)&&(id < sizeof(lcfg_strs)/sizeof(lcfg_strs[0]))&&(lcfg_strs[id].name))
-        return lcfg_strs[id].cur;
+    LCFG_READY
+    LCFG_CAPTURE(LCONFIG_CGETSTR, id, 0, NULL)
+    struct lcfg_str* cfg = lcfgStr(id);
+    if (cfg) {
+        LCFG_READ(cfg)
+        #ifdef LCONFIG_OVERRIDE
+        struct lcfg_ovr* ovr = lcfg_novrs ? lcfgOverride(LCFG_STR, id) : NULL;
+        if (ovr) return ovr->str;
+        #endif
+        LCFG_DECODE(LCFG_STR, id)
+        return lcfgStrCur(cfg);
+    }
     return NULL;
 }
 LCONDEF void lconfigSetString (int id, const char* val) {
-    if ((id >= 0)&&(id < sizeof(lcfg_strs)/sizeof(lcfg_strs[0]))&&(lcfg_strs[id].name))
-        lcfgStrSet(&lcfg_strs[id], val);
+    LCFG_READY
+    LCFG_CAPTURE(LCONFIG_CSETSTR, id, 0, val)
+    struct lcfg_str* cfg = lcfgStr(id);
+    if (cfg) {
+        LCFG_DECODE(LCFG_STR, id)
+        LCFG_WRITE(cfg)
+        int clamped = lcfgStrSet(cfg, val);
+        LCFG_PROV(LCFG_STR, id, LCONFIG_SSET, 0, clamped)
+    }
+}
+#ifdef LCONFIG_SPANS
+LCONDEF const char* lconfigGetStringSpan (int id, int* len) {
+    const char* str = lconfigGetString(id);
+    const struct lcfg_str* cfg = lcfgStr(id);
+    *len = (!str) ? 0 : ((cfg->span)&&(str == cfg->span)) ? (int)cfg->slen : (int)strlen(str);
+    return str;
 }
+#endif
+LCONDEF int lconfigFindInt (const char* name, int len) {
+    LCFG_READY
+    const struct lcfg_key* key = lcfgKey(name, (len < 0) ? strlen(name) : (size_t)len, LCFG_INT);
+    return key ? key->id : -1;
+}
+LCONDEF int lconfigFindString (const char* name, int len) {
+    LCFG_READY
+    const struct lcfg_key* key = lcfgKey(name, (len < 0) ? strlen(name) : (size_t)len, LCFG_STR);
+    return key ? key->id : -1;
+}
+LCONDEF int lconfigFindMap (const char* name, int len) {
+    LCFG_READY
+    const struct lcfg_key* key = lcfgKey(name, (len < 0) ? strlen(name) : (size_t)len, LCFG_MAP);
+    return key ? key->id : -1;
+}
+LCONDEF int lconfigMapGet (int id, const char* key, int len) {
+    LCFG_READY
+    struct lcfg_map* map = lcfgMap(id);
+    if (!map) return -1;
+    int ent = lcfgMapFind(map, key, (len < 0) ? strlen(key) : (size_t)len);
+    return (ent < 0) ? map->def : map->ents[ent].val;
+}
+LCONDEF int lconfigMapSet (int id, const char* key, int len, int val) {
+    LCFG_READY
+    struct lcfg_map* map = lcfgMap(id);
+    size_t klen = (len < 0) ? strlen(key) : (size_t)len;
+    if ((!map)||(!klen)||(memchr(key, ' ', klen))||(memchr(key, '\n', klen))) return -1;
+    return lcfgMapSet(map, key, klen, val);
+}
+LCONDEF int lconfigGetIntByName (const char* name, int len) {
+    return lconfigGetInt(lconfigFindInt(name, len));
+}
+LCONDEF void lconfigSetIntByName (const char* name, int len, int val) {
+    lconfigSetInt(lconfigFindInt(name, len), val);
+}
+LCONDEF const char* lconfigGetStringByName (const char* name, int len) {
+    return lconfigGetString(lconfigFindString(name, len));
+}
+LCONDEF void lconfigSetStringByName (const char* name, int len, const char* val) {
+    lconfigSetString(lconfigFindString(name, len), val);
+}
+LCONDEF int lconfigCount () {
+    #ifdef LCONFIG_DYNAMIC
+    return LCFG_NLAYS - 1 + lcfg_dyn_nlays; //all but the trailing entry, then registered ones
+    #else
+    return LCFG_NLAYS - 1; //all but the trailing entry
+    #endif
+}
+LCONDEF int lconfigIterate (int* cursor, struct lconfig_info* info) {
+    LCFG_READY
+    if ((*cursor < 0)||(*cursor >= lconfigCount())) return 0;
+    struct lconfig_info out = {0};
+    if (*cursor < LCFG_NLAYS - 1) {
+        out.type = lcfg_lays[*cursor].type;
+        out.id = lcfg_lays[*cursor].id;
+    }
+    #ifdef LCONFIG_DYNAMIC
+    else {
+        out.type = lcfg_dyn_lays[*cursor - (LCFG_NLAYS - 1)].type;
+        out.id = lcfg_dyn_lays[*cursor - (LCFG_NLAYS - 1)].id;
+    }
+    #endif
+    (*cursor)++;
+    lcfgInfo(out.type, out.id, info);
+    return 1;
+}
+LCONDEF int lconfigIterateSection (const char* section, int len, int* cursor, struct lconfig_info* info) {
+    LCFG_READY
+    size_t slen = (len < 0) ? strlen(section) : (size_t)len;
+    int num = lcfgSorted();
+    if (*cursor == 0) { //binary search for the first name at or after "section."
+        int lo = 0, hi = num;
+        while (lo < hi) {
+            int mid = (lo + hi)/2;
+            const struct lcfg_key* key = &lcfg_sorted[mid];
+            const char* name = lcfgName(key->type, key->id);
+            int cmp = memcmp(name, section, (slen < (size_t)key->len) ? slen : (size_t)key->len);
+            size_t klen = key->len;
+            if ((cmp < 0)||((cmp == 0)&&((klen <= slen)||((unsigned char)name[slen] < '.')))) lo = mid + 1;
+            else hi = mid;
+        }
+        *cursor = lo + 1; //cursor holds the next index + 1, so 0 can mean start
+    }
+    if ((*cursor < 1)||(*cursor > num)) return 0;
+    const struct lcfg_key* key = &lcfg_sorted[*cursor - 1];
+    const char* name = lcfgName(key->type, key->id);
+    if (((size_t)key->len <= slen + 1)||(memcmp(name, section, slen) != 0)||(name[slen] != '.')) {
+        *cursor = num + 1; //left the subtree, stay done
+        return 0;
+    }
+    (*cursor)++;
+    lcfgInfo(key->type, key->id, info);
+    return 1;
+}
+#ifdef LCONFIG_DYNAMIC
+LCONDEF int lconfigRegisterInt (const char* name, int min, int max, int def) {
+    LCFG_READY
+    if (min > max) return -1;
+    if (def < min) def = min;
+    if (def > max) def = max;
+    struct lcfg_int cfg = {.name = NULL, .min = min, .max = max, .def = def, .cur = def};
+    return lcfgRegister(LCFG_INT, name, &cfg);
+}
+LCONDEF int lconfigRegisterString (const char* name, int len, const char* def) {
+    LCFG_READY
+    if ((len < 0)||(!def)) return -1;
+    struct lcfg_str cfg = {.name = NULL, .len = len, .def = def, .cur = NULL};
+    return lcfgRegister(LCFG_STR, name, &cfg);
+}
+#endif
+#ifdef LCONFIG_OVERRIDE
+LCONDEF int lconfigPush () {
+    if (lcfg_novrs == LCONFIG_OVERRIDE) return -1;
+    struct lcfg_ovr ovr = {0};
+    lcfg_ovrs[lcfg_novrs++] = ovr;
+    return 0;
+}
+LCONDEF void lconfigPop () {
+    while (lcfg_novrs) { //unwind overrides up to and including the scope marker
+        struct lcfg_ovr* ovr = &lcfg_ovrs[--lcfg_novrs];
+        if (!ovr->type) break;
+        free(ovr->str);
+    }
+}
+LCONDEF int lconfigOverrideInt (int id, int val) {
+    struct lcfg_int* cfg = lcfgInt(id);
+    if (!cfg) return -1;
+    struct lcfg_ovr* ovr = lcfgOverridePush(LCFG_INT, id);
+    if (!ovr) return -1;
+    ovr->val = (val < cfg->min) ? cfg->min : (val > cfg->max) ? cfg->max : val;
+    return 0;
+}
+LCONDEF int lconfigOverrideString (int id, const char* val) {
+    struct lcfg_str* cfg = lcfgStr(id);
+    if (!cfg) return -1;
+    size_t len = strcspn(val, "\n"); //same clamping as lcfgStrSet
+    if (len > (size_t)cfg->len) len = cfg->len;
+    char* str = malloc(len + 1);
+    if (!str) return -1;
+    memcpy(str, val, len);
+    str[len] = 0;
+    struct lcfg_ovr* ovr = lcfgOverridePush(LCFG_STR, id);
+    if (!ovr) {
+        free(str);
+        return -1;
+    }
+    ovr->str = str;
+    return 0;
+}
+#endif
+#ifdef LCONFIG_PROVENANCE
+LCONDEF int lconfigSource (int type, int id, struct lconfig_source* src) {
+    LCFG_READY
+    const uint32_t* prov = lcfgProv(type, id);
+    if (!prov) return -1;
+    LCFG_DECODE(type, id)
+    src->source = *prov&3;
+    src->clamped = (*prov >> 2)&1;
+    src->line = *prov >> 3;
+    return 0;
+}
+#endif
+#ifdef LCONFIG_STATS
+LCONDEF struct lconfig_stats lconfigStats () {
+    //counters are copied one by one, so each is consistent but the snapshot as a whole may not be
+    struct lconfig_stats out;
+    unsigned long long* dst = (unsigned long long*)&out;
+    unsigned long long* src = (unsigned long long*)&lcfg_stats;
+    for (size_t i = 0; i < sizeof(out)/sizeof(*dst); i++) {
+        #if defined(__GNUC__)||defined(__clang__)
+        dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+        #else
+        dst[i] = src[i];
+        #endif
+    }
+    return out;
+}
+#endif
+#ifdef LCONFIG_TRACE
+LCONDEF void lconfigTrace (const struct lconfig_trace* hooks) {
+    static const struct lconfig_trace none = {0};
+    lcfg_trace = hooks ? *hooks : none;
+}
+#endif
+#ifdef LCONFIG_CAPTURE
+LCONDEF int lconfigCapture (const char* path) {
+    if (lcfg_capf) { //stop the running capture first, flushing every thread's buffer
+        for (struct lcfg_cap* cap = lcfg_caps; cap; cap = cap->next) lcfgCaptureFlush(cap);
+        fclose(lcfg_capf);
+        lcfg_capf = NULL;
+    }
+    if (!path) return 0;
+    FILE* fpt = fopen(path, "wb");
+    if (!fpt) return -1;
+    fwrite("LCFGCAP1", 1, 8, fpt);
+    lcfg_capt = lcfgNanos();
+    lcfg_capf = fpt;
+    return 0;
+}
+#endif
+#ifdef LCONFIG_PROFILE
+LCONDEF int lconfigProfile (struct lconfig_prof* out, int max) {
+    //ranks every config value, then keeps the requested number of entries
+    struct lconfig_prof* all = malloc((LCFG_ALLINTS + LCFG_ALLSTRS)*sizeof(struct lconfig_prof));
+    int num = 0;
+    if (!all) return 0;
+    for (int i = 0; i < LCFG_ALLINTS; i++) {
+        const struct lcfg_int* cfg = lcfgInt(i);
+        if (!cfg) continue;
+        struct lconfig_prof prof = {LCFG_INT, i, cfg->name, (int)strlen(cfg->name) - 1, cfg->reads,
+            cfg->writes};
+        all[num++] = prof;
+    }
+    for (int i = 0; i < LCFG_ALLSTRS; i++) {
+        const struct lcfg_str* cfg = lcfgStr(i);
+        if (!cfg) continue;
+        struct lconfig_prof prof = {LCFG_STR, i, cfg->name, (int)strlen(cfg->name) - 1, cfg->reads,
+            cfg->writes};
+        all[num++] = prof;
+    }
+    qsort(all, num, sizeof(struct lconfig_prof), lcfgProfCompare);
+    if (num > max) num = max;
+    if (num > 0) memcpy(out, all, num*sizeof(struct lconfig_prof));
+    free(all);
+    return num > 0 ? num : 0;
+}
+LCONDEF void lconfigProfileReset () {
+    for (int i = 0; i < LCFG_ALLINTS; i++) if (lcfgInt(i)) lcfgInt(i)->reads = lcfgInt(i)->writes = 0;
+    for (int i = 0; i < LCFG_ALLSTRS; i++) if (lcfgStr(i)) lcfgStr(i)->reads = lcfgStr(i)->writes = 0;
+}
+#endif
 
 //internal functions
-static void lcfgIntRead (struct lcfg_int* cfg, const char* txt) {
-    if (strncmp(cfg->name, txt, strlen(cfg->name)) == 0)
-        lcfgIntSet(cfg, atoi(&txt[strlen(cfg->name)]));
+static struct lcfg_int* lcfgInt (int id) {
+    //returns the int with the given ID, NULL if there is none
+    if ((id >= 0)&&(id < LCFG_NINTS)) return lcfg_ints[id].name ? &lcfg_ints[id] : NULL;
+    #ifdef LCONFIG_DYNAMIC
+    if ((id >= LCFG_NINTS)&&(id < LCFG_ALLINTS)) return &lcfg_dyn_ints[id - LCFG_NINTS];
+    #endif
+    return NULL;
+}
+static struct lcfg_str* lcfgStr (int id) {
+    //returns the str with the given ID, NULL if there is none
+    if ((id >= 0)&&(id < LCFG_NSTRS)) return lcfg_strs[id].name ? &lcfg_strs[id] : NULL;
+    #ifdef LCONFIG_DYNAMIC
+    if ((id >= LCFG_NSTRS)&&(id < LCFG_ALLSTRS)) return &lcfg_dyn_strs[id - LCFG_NSTRS];
+    #endif
+    return NULL;
+}
+static struct lcfg_map* lcfgMap (int id) {
+    //returns the map with the given ID, NULL if there is none
+    return ((id >= 0)&&(id < LCFG_NMAPS)&&(lcfg_maps[id].name)) ? &lcfg_maps[id] : NULL;
+}
+static const char* lcfgName (int type, int id) {
+    //returns the name (followed by a space) of an existing config value of any type
+    if (type == LCFG_INT) return lcfgInt(id)->name;
+    return (type == LCFG_STR) ? lcfgStr(id)->name : lcfgMap(id)->name;
+}
+static int lcfgWithin (const char* name, const char* sub, size_t sublen) {
+    //checks whether a name lies within the given section
+    return (strncmp(name, sub, sublen) == 0)&&(name[sublen] == '.');
 }
-static void lcfgStrRead (struct lcfg_str* cfg, const char* txt) {
-    if (strncmp(cfg->name, txt, strlen(cfg->name)) == 0)
-        lcfgStrSet(cfg, &txt[strlen(cfg->name)]);
+static void lcfgMapPrint (struct lcfg_map* cfg, const char* name, FILE* fpt) {
+    for (int i = 0; i < cfg->cnt; i++)
+        fprintf(fpt, "%s%.*s %d\n", name, cfg->ents[i].len, &cfg->keys[cfg->ents[i].off], cfg->ents[i].val);
 }
+static void lcfgSparse (FILE* fpt, int sections) {
+    //writes config values that differ from their defaults, top level names first, then by section
+    int num = lcfgSorted();
+    const char* sec = NULL; //section of the last header written
+    int slen = 0;
+    for (int pass = 0; pass < 2; pass++) for (int i = 0; i < num; i++) {
+        const struct lcfg_key* key = &lcfg_sorted[i];
+        const char* name = lcfgName(key->type, key->id);
+        const char* dot = strrchr(name, '.');
+        int cut = (sections)&&(dot) ? (int)(dot - name) : 0; //section part of the name
+        if ((pass == 0) != (cut == 0)) continue;
+        if (key->type == LCFG_INT) {
+            if (lcfgInt(key->id)->cur == lcfgInt(key->id)->def) continue;
+        } else if (key->type == LCFG_STR) {
+            if (strcmp(lcfgStrCur(lcfgStr(key->id)), lcfgStr(key->id)->def) == 0) continue;
+        } else if (!lcfgMap(key->id)->cnt) {
+            continue;
+        }
+        if ((cut)&&((!sec)||(cut != slen)||(memcmp(name, sec, cut) != 0))) {
+            fprintf(fpt, "[%.*s]\n", cut, name);
+            sec = name;
+            slen = cut;
+        }
+        if (cut) name += cut + 1;
+        if (key->type == LCFG_INT) fprintf(fpt, "%s%d\n", name, lcfgInt(key->id)->cur);
+        else if (key->type == LCFG_STR) fprintf(fpt, "%s%s\n", name, lcfgStrCur(lcfgStr(key->id)));
+        else lcfgMapPrint(lcfgMap(key->id), name, fpt);
+    }
+}
+static int lcfgMapFind (const struct lcfg_map* cfg, const char* key, size_t len) {
+    //returns the index of the entry with the given key, -1 if there is none
+    if (!cfg->cnt) return -1;
+    uint32_t hash = lcfgHash(key, len, 0);
+    for (int i = hash&(cfg->cap - 1); cfg->slots[i]; i = (i + 1)&(cfg->cap - 1)) {
+        const struct lcfg_ent* ent = &cfg->ents[cfg->slots[i] - 1];
+        if ((ent->hash == hash)&&(ent->len == (int)len)&&(memcmp(&cfg->keys[ent->off], key, len) == 0))
+            return cfg->slots[i] - 1;
+    }
+    return -1;
+}
+static int lcfgMapSet (struct lcfg_map* cfg, const char* key, size_t len, int val) {
+    //sets the value of a key, adding it if there is room, returns 0 on success and -1 otherwise
+    if (val < cfg->min) {
+        val = cfg->min;
+        LCFG_STAT(clamped, 1)
+    }
+    if (val > cfg->max) {
+        val = cfg->max;
+        LCFG_STAT(clamped, 1)
+    }
+    int idx = lcfgMapFind(cfg, key, len);
+    if (idx >= 0) {
+        cfg->ents[idx].val = val;
+        return 0;
+    }
+    if (cfg->cnt == cfg->num) {
+        LCFG_STAT(truncated, 1)
+        return -1;
+    }
+    if (!cfg->ents) { //first use, size the table for num entries at most half full
+        int cap = 2;
+        while (cap < 2*cfg->num) cap *= 2;
+        cfg->ents = malloc(cfg->num*sizeof(struct lcfg_ent));
+        cfg->slots = calloc(cap, sizeof(int));
+        if ((!cfg->ents)||(!cfg->slots)) {
+            free(cfg->ents);
+            free(cfg->slots);
+            cfg->ents = NULL;
+            cfg->slots = NULL;
+            return -1;
+        }
+        cfg->cap = cap;
+    }
+    if (cfg->klen + len > cfg->kcap) { //keys are packed into one growing buffer
+        size_t cap = cfg->kcap ? cfg->kcap*2 : 64;
+        while (cap < cfg->klen + len) cap *= 2;
+        char* keys = realloc(cfg->keys, cap);
+        if (!keys) return -1;
+        cfg->keys = keys;
+        cfg->kcap = cap;
+    }
+    memcpy(&cfg->keys[cfg->klen], key, len);
+    struct lcfg_ent ent = {lcfgHash(key, len, 0), (int)cfg->klen, (int)len, val};
+    cfg->klen += len;
+    int slot = ent.hash&(cfg->cap - 1);
+    while (cfg->slots[slot]) slot = (slot + 1)&(cfg->cap - 1);
+    cfg->ents[cfg->cnt++] = ent;
+    cfg->slots[slot] = cfg->cnt;
+    return 0;
+}
+static void lcfgMapClear (struct lcfg_map* cfg) {
+    //removes all entries, keeping the allocated storage
+    if (cfg->slots) memset(cfg->slots, 0, cfg->cap*sizeof(int));
+    cfg->cnt = 0;
+    cfg->klen = 0;
+}
+#if !defined(LCONFIG_TABLES)||defined(LCONFIG_DYNAMIC)
 static void lcfgIntPrint (struct lcfg_int* cfg, FILE* fpt) {
     fprintf(fpt, "%s%d\n", cfg->name, cfg->cur);
 }
 static void lcfgStrPrint (struct lcfg_str* cfg, FILE* fpt) {
-    fprintf(fpt, "%s%s\n", cfg->name, cfg->cur);
+    fprintf(fpt, "%s%s\n", cfg->name, lcfgStrCur(cfg));
 }
-static void lcfgIntSet (struct lcfg_int* cfg, int val) {
-    if (val < cfg->min) val = cfg->min;
-    if (val > cfg->max) val = cfg->max;
+#endif
+static int lcfgIntSet (struct lcfg_int* cfg, int val) {
+    //returns 1 if the value was clamped, 0 otherwise
+    int clamped = 0;
+    if (val < cfg->min) {
+        val = cfg->min;
+        clamped = 1;
+        LCFG_STAT(clamped, 1)
+    }
+    if (val > cfg->max) {
+        val = cfg->max;
+        clamped = 1;
+        LCFG_STAT(clamped, 1)
+    }
+    #ifdef LCONFIG_NUMA
+    lcfgReplicaSet(cfg, val);
+    #else
     cfg->cur = val;
+    #endif
+    return clamped;
 }
-static void lcfgStrSet (struct lcfg_str* cfg, const char* val) {
+static int lcfgParse (const char* txt, int* val) {
+    //parses a decimal, 0x hex or 0b binary int into val, saturating at INT_MIN/INT_MAX instead of overflowing
+    //returns 0 if only whitespace follows, 1 on trailing garbage, -1 without any digits (val is unchanged)
+    const char* pos = txt + strspn(txt, " \t");
+    int neg = (*pos == '-');
+    if ((*pos == '-')||(*pos == '+')) pos++;
+    int base = 10;
+    if ((pos[0] == '0')&&((pos[1]|0x20) == 'x')) base = 16;
+    if ((pos[0] == '0')&&((pos[1]|0x20) == 'b')) base = 2;
+    if (base != 10) pos += 2;
+    size_t len = 0, sig; //digits, and digits after leading zeros
+    if (base == 10) {
+        while ((unsigned char)(pos[len] - '0') < 10) len++;
+    } else if (base == 16) {
+        while (((unsigned char)(pos[len] - '0') < 10)||((unsigned char)((pos[len]|0x20) - 'a') < 6)) len++;
+    } else {
+        while ((pos[len] == '0')||(pos[len] == '1')) len++;
+    }
+    if ((!len)&&(base != 10)) { //just a zero followed by garbage
+        *val = 0;
+        return 1;
+    }
+    if (!len) return -1;
+    const char* end = pos + len;
+    for (sig = len; (sig > 1)&&(*pos == '0'); sig--) pos++;
+    uint64_t num = 0, lim = neg ? (uint64_t)INT_MAX + 1 : INT_MAX;
+    if (sig > ((base == 10) ? 10 : (base == 16) ? 8 : 32)) { //too many digits for 32 bits
+        num = lim;
+    } else if (base == 10) {
+        #ifdef LCFG_SWAR
+        if (sig >= 8) num = lcfgDigits8(pos), pos += 8, sig -= 8;
+        if (sig >= 4) num = num*10000 + lcfgDigits4(pos), pos += 4, sig -= 4;
+        #endif
+        for (; sig; sig--) num = num*10 + (*pos++ - '0');
+    } else {
+        for (; sig; sig--, pos++) num = num*base + ((*pos <= '9') ? *pos - '0' : (*pos|0x20) - 'a' + 10);
+    }
+    if (num > lim) num = lim;
+    *val = neg ? (int)(-(int64_t)num) : (int)num;
+    return end[strspn(end, " \t\r\n")] != '\0';
+}
+#ifdef LCFG_SWAR
+static uint32_t lcfgDigits4 (const char* txt) {
+    //converts 4 decimal digits at once, the first one ends up in the lowest byte
+    uint32_t val;
+    memcpy(&val, txt, 4);
+    val &= 0x0F0F0F0F;
+    val = (val*10 + (val >> 8))&0x00FF00FF; //pairs of digits
+    return (val*100 + (val >> 16))&0xFFFF;
+}
+static uint32_t lcfgDigits8 (const char* txt) {
+    //converts 8 decimal digits at once, the first one ends up in the lowest byte
+    uint64_t val;
+    memcpy(&val, txt, 8);
+    val &= 0x0F0F0F0F0F0F0F0F;
+    val = (val*10 + (val >> 8))&0x00FF00FF00FF00FF; //pairs of digits
+    val = (val*100 + (val >> 16))&0x0000FFFF0000FFFF; //groups of four
+    return (uint32_t)((val*10000 + (val >> 32))&0xFFFFFFFF);
+}
+#endif
+static int lcfgStrSet (struct lcfg_str* cfg, const char* val) {
+    //returns 1 if the value was truncated, 0 otherwise
     size_t len = strcspn(val, "\n"); //find first newline
-    if (len > cfg->len) len = cfg->len; //clamp to value max length
+    int truncated = (len > (size_t)cfg->len);
+    if (truncated) { //clamp to value max length
+        len = cfg->len;
+        LCFG_STAT(truncated, 1)
+    }
     strncpy(cfg->cur, val, len); //copy string up to len characters
     cfg->cur[len] = 0; //make sure string is properly terminated
+    #ifdef LCONFIG_SPANS
+    cfg->span = NULL; //the copy is current now
+    #endif
+    return truncated;
+}
+static const char* lcfgStrCur (const struct lcfg_str* cfg) {
+    //returns the current value of a string
+    #ifdef LCONFIG_SPANS
+    if (cfg->span) return cfg->span;
+    #endif
+    return cfg->cur;
+}
+#ifdef LCONFIG_SPANS
+static int lcfgStrSpan (struct lcfg_str* cfg, char* val) {
+    //makes a string refer to its value in the file buffer, which is NUL terminated at the end of the line
+    //returns 1 if the value was truncated, 0 otherwise
+    size_t len = strlen(val);
+    int truncated = (len > (size_t)cfg->len);
+    if (truncated) { //clamp to value max length, in place
+        len = cfg->len;
+        val[len] = 0;
+        LCFG_STAT(truncated, 1)
+    }
+    cfg->span = val;
+    cfg->slen = len;
+    return truncated;
+}
+#endif
+#if defined(LCONFIG_SPANS)||defined(LCONFIG_PATCH)||defined(LCONFIG_PARALLEL)||defined(LCONFIG_LAZY)
+static char* lcfgSlurp (FILE* fpt, size_t* size) {
+    //reads a whole file into a NUL terminated buffer, returns NULL if out of memory
+    size_t len = 0, cap = 4096;
+    char* buf = malloc(cap);
+    while (buf) {
+        len += fread(&buf[len], 1, cap - len - 1, fpt);
+        if (len < cap - 1) break;
+        char* tmp = realloc(buf, cap *= 2);
+        if (!tmp) free(buf);
+        buf = tmp;
+    }
+    if (buf) buf[len] = 0;
+    *size = len;
+    return buf;
+}
+#endif
+static int lcfgRead (const char* sub, size_t sublen, int ms, int apply) {
+    //reads the config file, applying only config values within section sub if not NULL, or none if !apply
+    //waits up to ms milliseconds for the lock if locking, only reads that apply are traced and counted
+    int err = 1;
+    LCFG_CLOCK(beg)
+    if (apply) {
+        LCFG_HOOK(readBegin, LCONFIG_PATH)
+        LCFG_PROBE1(read_begin, LCONFIG_PATH)
+    }
+    FILE* cfg = fopen(LCONFIG_PATH, "r");
+    #ifdef LCONFIG_LOCK
+    if ((cfg)&&(lcfgLock(fileno(cfg), 0, ms))) {
+        fclose(cfg);
+        cfg = NULL;
+        err = 2;
+    }
+    #else
+    (void)ms;
+    #endif
+    #if defined(LCONFIG_SPANS)||defined(LCONFIG_PARALLEL)||defined(LCONFIG_LAZY)
+    size_t size;
+    char* buf = cfg ? lcfgSlurp(cfg, &size) : NULL;
+    if ((cfg)&&(!buf)) {
+        fclose(cfg);
+        cfg = NULL;
+    }
+    #endif
+    if (cfg) {
+        #if !defined(LCONFIG_SPANS)&&!defined(LCONFIG_PARALLEL)&&!defined(LCONFIG_LAZY)
+        char txt[LCONFIG_LMAX];
+        #endif
+        #ifdef LCONFIG_LAZY
+        lcfgDecodeAll(); //values still pending point into the buffer of the last read, which is replaced
+        pthread_mutex_lock(&lcfg_lazy_lock); //values deferred by this read are decoded once it is done
+        lcfg_lazy_held = 1;
+        #endif
+        struct lcfg_read rd = {"", 0, sub, sublen, apply, 0, 0, NULL};
+        for (int i = 0; (apply)&&(i < LCFG_NMAPS); i++) //maps are replaced by the file contents
+            if ((lcfg_maps[i].name)&&((!sub)||(lcfgWithin(lcfg_maps[i].name, sub, sublen))))
+                lcfgMapClear(&lcfg_maps[i]);
+        #ifdef LCONFIG_PATCH
+        struct stat st;
+        lcfg_fsize = -1;
+        if (stat(LCONFIG_PATH, &st) == 0) lcfgStamp(&st); //offsets belong to this version of the file
+        for (int i = 0; i < LCFG_ALLINTS; i++) if (lcfgInt(i)) lcfgInt(i)->loc.pos = 0;
+        for (int i = 0; i < LCFG_ALLSTRS; i++) if (lcfgStr(i)) lcfgStr(i)->loc.pos = 0;
+        #endif
+        #ifdef LCONFIG_STATS
+        memset(&lcfg_pass, 0, sizeof(lcfg_pass));
+        lcfg_gen++;
+        #endif
+        #if defined(LCONFIG_SPANS)||defined(LCONFIG_PARALLEL)||defined(LCONFIG_LAZY)
+        char* txt = buf;
+        #ifdef LCONFIG_PARALLEL
+        if (lcfgParallel(buf, size, &rd) == 0) txt = &buf[size]; //all lines were applied already
+        #endif
+        while (*txt) { //split lines in place, string values keep pointing into buf with spans
+            char* nxt = &txt[strcspn(txt, "\n")];
+            int eol = (*nxt == '\n');
+            *nxt = 0;
+            rd.pos = txt - buf;
+            rd.line++;
+            lcfgLine(txt, &rd);
+            #ifdef LCONFIG_STATS
+            lcfg_pass.rbytes += eol; //count the newline replaced above
+            #endif
+            txt = nxt + eol;
+        }
+        #ifdef LCONFIG_SPANS
+        for (int i = 0; i < LCFG_ALLSTRS; i++) { //copy strings still pointing into the old buffer
+            struct lcfg_str* str = lcfgStr(i);
+            if ((str)&&(str->span)&&((uintptr_t)str->span >= (uintptr_t)lcfg_buf)
+                &&((uintptr_t)str->span < (uintptr_t)lcfg_buf + lcfg_buflen + 1)) {
+                memcpy(str->cur, str->span, str->slen + 1);
+                str->span = NULL;
+            }
+        }
+        free(lcfg_buf);
+        lcfg_buf = buf;
+        lcfg_buflen = size;
+        #elif defined(LCONFIG_LAZY)
+        free(lcfg_buf); //nothing points into it anymore
+        lcfg_buf = buf;
+        lcfg_buflen = size;
+        #else
+        free(buf);
+        #endif
+        #else
+        for (int eol = 1; fgets(txt, LCONFIG_LMAX, cfg); ) {
+            size_t len = strlen(txt);
+            rd.line += eol; //lines longer than LMAX arrive in pieces
+            eol = (len)&&(txt[len-1] == '\n');
+            lcfgLine(txt, &rd);
+            rd.pos += len;
+        }
+        #endif
+        #ifdef LCONFIG_PATCH
+        lcfg_fsec = (rd.slen > 0);
+        #endif
+        #ifdef LCONFIG_LAZY
+        lcfg_lazy_held = 0;
+        pthread_mutex_unlock(&lcfg_lazy_lock);
+        #endif
+        #ifdef LCONFIG_TRACE
+        long len = ftell(cfg);
+        #endif
+        fclose(cfg);
+        if (!apply) return 0; //locating values for lconfigPatch is part of its write
+        LCFG_CLOCK(end)
+        LCFG_HOOK(readEnd, (len > 0) ? len : 0, end - beg)
+        LCFG_PROBE2(read_end, (len > 0) ? len : 0, end - beg)
+        #ifdef LCONFIG_STATS
+        lcfg_stats.lread = end - beg;
+        lcfg_stats.lparse = lcfg_pass.tparse;
+        lcfg_stats.lapply = lcfg_pass.tapply;
+        lcfgStatAdd(&lcfg_stats.tread, lcfg_stats.lread);
+        lcfgStatAdd(&lcfg_stats.tparse, lcfg_pass.tparse);
+        lcfgStatAdd(&lcfg_stats.tapply, lcfg_pass.tapply);
+        lcfgStatAdd(&lcfg_stats.lines, lcfg_pass.lines);
+        lcfgStatAdd(&lcfg_stats.rbytes, lcfg_pass.rbytes);
+        lcfgStatAdd(&lcfg_stats.unknown, lcfg_pass.unknown);
+        lcfgStatAdd(&lcfg_stats.matched, lcfg_pass.matched);
+        lcfgStatAdd(&lcfg_stats.duplicate, lcfg_pass.duplicate);
+        lcfgStatAdd(&lcfg_stats.reads, 1);
+        #endif
+        return 0;
+    }
+    #ifdef LCONFIG_TRACE
+    LCFG_CLOCK(end)
+    if (apply) {
+        LCFG_HOOK(readEnd, 0, end - beg)
+        LCFG_PROBE2(read_end, 0, end - beg)
+    }
+    #endif
+    return err;
+}
+#ifdef LCONFIG_PATCH
+struct lcfg_patch {
+    struct lcfg_loc* loc; //location of the value in the file
+    int type, id; //config value
+};
+static int lcfgPatch (int ms) {
+    //patches changed values into the config file, instrumented like lcfgWrite
+    struct stat st;
+    if ((stat(LCONFIG_PATH, &st))||(st.st_size == 0)) return lcfgWrite(ms, -1); //nothing to patch
+    long len = 0;
+    LCFG_CLOCK(beg)
+    LCFG_HOOK(writeBegin, LCONFIG_PATH)
+    LCFG_PROBE1(write_begin, LCONFIG_PATH)
+    int err = lcfgPatchFile(ms, &len);
+    if (err < 0) { //removed meanwhile, write a full file instead
+        #ifdef LCONFIG_TRACE
+        LCFG_CLOCK(end)
+        LCFG_HOOK(writeEnd, 0, end - beg)
+        LCFG_PROBE2(write_end, 0, end - beg)
+        #endif
+        return lcfgWrite(ms, -1);
+    }
+    LCFG_CLOCK(end)
+    LCFG_HOOK(writeEnd, err ? 0 : len, end - beg)
+    LCFG_PROBE2(write_end, err ? 0 : len, end - beg)
+    #ifdef LCONFIG_STATS
+    if (!err) {
+        lcfg_stats.lwrite = end - beg;
+        lcfgStatAdd(&lcfg_stats.twrite, lcfg_stats.lwrite);
+        lcfgStatAdd(&lcfg_stats.wbytes, len);
+        lcfgStatAdd(&lcfg_stats.writes, 1);
+    }
+    #endif
+    (void)len;
+    return err;
+}
+static int lcfgPatchFile (int ms, long* bytes) {
+    //patches changed values into the config file, see lconfig patch
+    //returns -1 if there is no file to patch, otherwise like lcfgWrite with the bytes written in bytes
+    #ifdef LCONFIG_DURABLE
+    int level = lcfg_durable;
+    #endif
+    #ifdef LCONFIG_LAZY
+    lcfgDecodeAll(); //changes are found by comparing decoded values with the file
+    #endif
+    for (int tries = 0; tries < 3; tries++) { //retry if the file changes between checking and locking
+        struct stat st;
+        if ((stat(LCONFIG_PATH, &st))||(st.st_size == 0)) return -1; //nothing to patch
+        if (lcfgStale(&st)) { //offsets are stale, rescan them
+            int err = lcfgRead(NULL, 0, ms, 0);
+            if (err) return err;
+        }
+        FILE* cfg = fopen(LCONFIG_PATH, "r+b");
+        if (!cfg) return 1;
+        #ifdef LCONFIG_LOCK
+        if (lcfgLock(fileno(cfg), 1, ms)) {
+            fclose(cfg);
+            return 2;
+        }
+        #endif
+        if ((stat(LCONFIG_PATH, &st))||(lcfgStale(&st))||(!lcfgSame(fileno(cfg)))) {
+            fclose(cfg); //changed or replaced before we got the lock
+            continue;
+        }
+        //collect changed values, and whether all of them can be patched in place
+        int num = 0, fits = 1;
+        struct lcfg_patch* chg = malloc((LCFG_ALLINTS + LCFG_ALLSTRS + 1)*sizeof(struct lcfg_patch));
+        if (!chg) {
+            fclose(cfg);
+            return 1;
+        }
+        for (int t = LCFG_INT; t <= LCFG_STR; t++) for (int i = 0, cnt = (t == LCFG_INT) ? LCFG_ALLINTS :
+            LCFG_ALLSTRS; i < cnt; i++) {
+            struct lcfg_loc* loc = (t == LCFG_INT) ? (lcfgInt(i) ? &lcfgInt(i)->loc : NULL) :
+                (lcfgStr(i) ? &lcfgStr(i)->loc : NULL);
+            if (!loc) continue;
+            char dig[16];
+            int len;
+            const char* txt = lcfgText(t, i, dig, &len);
+            if (loc->pos) {
+                if (lcfgHash(txt, len, 0) == loc->hash) continue;
+                if ((len > loc->len)||((t == LCFG_STR)&&(len != loc->len))) fits = 0;
+            } else if ((t == LCFG_INT) ? (lcfgInt(i)->cur == lcfgInt(i)->def) :
+                (strcmp(txt, lcfgStr(i)->def) == 0)) {
+                continue; //missing from the file and at its default, leave it that way
+            }
+            struct lcfg_patch ent = {loc, t, i};
+            chg[num++] = ent;
+        }
+        qsort(chg, num, sizeof(struct lcfg_patch), lcfgPatchCompare); //by offset, appended ones last
+        if (lcfgVerify(cfg, chg, num)) { //rewritten within the timestamp granularity, rescan it
+            lcfg_fsize = -1;
+            free(chg);
+            fclose(cfg);
+            continue;
+        }
+        int err = 0;
+        if (fits) { //overwrite values in place, then append missing ones
+            for (int i = 0; (i < num)&&(!err); i++) {
+                char dig[16];
+                int len;
+                const char* txt = lcfgText(chg[i].type, chg[i].id, dig, &len);
+                struct lcfg_loc* loc = chg[i].loc;
+                if (!loc->pos) {
+                    int nl = 1;
+                    if (fseek(cfg, -1, SEEK_END) == 0) nl = (fgetc(cfg) == '\n');
+                    if (fseek(cfg, 0, SEEK_END)) err = 1;
+                    long at = ftell(cfg);
+                    if (!nl) fputc('\n', cfg);
+                    if (lcfg_fsec) fputs("[]\n", cfg); //names are appended at the top level
+                    lcfg_fsec = 0;
+                    fputs(lcfgName(chg[i].type, chg[i].id), cfg);
+                    loc->pos = ftell(cfg) + 1;
+                    loc->len = len;
+                    fprintf(cfg, "%s\n", txt);
+                    *bytes += ftell(cfg) - at;
+                } else {
+                    if (fseek(cfg, loc->pos - 1, SEEK_SET)) err = 1;
+                    fwrite(txt, 1, len, cfg);
+                    for (int j = len; j < loc->len; j++) fputc(' ', cfg); //pad shorter ints
+                    *bytes += loc->len;
+                }
+                loc->hash = lcfgHash(txt, len, 0);
+            }
+            if ((fflush(cfg))||(ferror(cfg))) err = 1;
+            #ifdef LCONFIG_DURABLE
+            if ((!err)&&(lcfgSyncFile(fileno(cfg), level))) err = 1;
+            #endif
+            lcfg_fsize = -1;
+            if ((!err)&&(stat(LCONFIG_PATH, &st) == 0)) lcfgStamp(&st); //offsets are still valid
+            fclose(cfg);
+        } else { //rebuild the file once, copying everything but the changed values
+            size_t size, done = 0;
+            rewind(cfg); //verifying moved the position
+            char* buf = lcfgSlurp(cfg, &size);
+            FILE* tmp = buf ? fopen(LCONFIG_PATH ".tmp", "wb") : NULL;
+            if (tmp) {
+                for (int i = 0; i < num; i++) {
+                    char dig[16];
+                    int len;
+                    const char* txt = lcfgText(chg[i].type, chg[i].id, dig, &len);
+                    struct lcfg_loc* loc = chg[i].loc;
+                    if (loc->pos) {
+                        fwrite(&buf[done], 1, loc->pos - 1 - done, tmp);
+                        fwrite(txt, 1, len, tmp);
+                        done = loc->pos - 1 + loc->len;
+                    } else {
+                        if (done < size) fwrite(&buf[done], 1, size - done, tmp);
+                        if ((done < size)&&(buf[size-1] != '\n')) fputc('\n', tmp);
+                        if ((done < size)&&(lcfg_fsec)) fputs("[]\n", tmp); //close the last section
+                        done = size;
+                        fprintf(tmp, "%s%s\n", lcfgName(chg[i].type, chg[i].id), txt);
+                    }
+                }
+                if (done < size) fwrite(&buf[done], 1, size - done, tmp);
+                *bytes = ftell(tmp);
+                if (!lcfgSame(fileno(cfg))) { //replaced by a writer not honouring the lock, start over
+                    fclose(tmp);
+                    remove(LCONFIG_PATH ".tmp");
+                    free(buf);
+                    fclose(cfg);
+                    free(chg);
+                    lcfg_fsize = -1;
+                    continue;
+                }
+                #ifdef LCONFIG_DURABLE
+                if (lcfgCommit(tmp, level, -1, 1)) err = 1;
+                #else
+                if ((fclose(tmp))||(rename(LCONFIG_PATH ".tmp", LCONFIG_PATH))) err = 1;
+                #endif
+            } else {
+                err = 1;
+            }
+            free(buf);
+            fclose(cfg);
+            lcfg_fsize = -1; //offsets moved, the next patch rescans them
+        }
+        free(chg);
+        return err;
+    }
+    return 1;
+}
+static int lcfgSame (int fd) {
+    //checks that the config file is still the file open on fd, i.e. was not replaced by a rename
+    struct stat a, b;
+    if ((fstat(fd, &a))||(stat(LCONFIG_PATH, &b))) return 0;
+    return (a.st_dev == b.st_dev)&&(a.st_ino == b.st_ino);
+}
+static void lcfgLocate (int type, int id, long pos, const char* val) {
+    //remembers where an int or string is in the config file
+    struct lcfg_loc* loc = (type == LCFG_INT) ? &lcfgInt(id)->loc : &lcfgStr(id)->loc;
+    loc->pos = pos + 1;
+    loc->len = strcspn(val, "\n");
+    loc->hash = lcfgHash(val, lcfgLocated(type, id, val, loc->len), 0);
+}
+static size_t lcfgLocated (int type, int id, const char* val, int len) {
+    //returns how much of a value of len bytes in the file is hashed, i.e. what reading it would keep
+    //trailing spaces of ints and the part of strings beyond LEN do not count as changes
+    if (type == LCFG_INT) return strcspn(val, " \r\n");
+    return (len > lcfgStr(id)->len) ? (size_t)lcfgStr(id)->len : (size_t)len;
+}
+static const char* lcfgText (int type, int id, char* buf, int* len) {
+    //returns the current value of an int or string as written to the config file
+    if (type == LCFG_INT) {
+        *len = sprintf(buf, "%d", lcfgInt(id)->cur);
+        return buf;
+    }
+    const char* txt = lcfgStrCur(lcfgStr(id));
+    *len = strlen(txt);
+    return txt;
+}
+static int lcfgPatchCompare (const void* a, const void* b) {
+    //orders changes by file offset, values missing from the file last in ID order
+    const struct lcfg_patch* x = a;
+    const struct lcfg_patch* y = b;
+    long xp = x->loc->pos ? x->loc->pos : LONG_MAX, yp = y->loc->pos ? y->loc->pos : LONG_MAX;
+    if (xp != yp) return (xp < yp) ? -1 : 1;
+    return (x->type != y->type) ? x->type - y->type : x->id - y->id;
+}
+static void lcfgStamp (const struct stat* st) {
+    //remembers which version of the config file the offsets belong to
+    lcfg_fsize = st->st_size;
+    lcfg_ftime = st->st_mtime;
+    lcfg_fnsec = lcfgMtime(st);
+}
+static int lcfgStale (const struct stat* st) {
+    //checks whether the config file changed since the offsets were taken
+    return (st->st_size != lcfg_fsize)||(st->st_mtime != lcfg_ftime)||(lcfgMtime(st) != lcfg_fnsec);
+}
+static long lcfgMtime (const struct stat* st) {
+    //returns the nanoseconds of the modification time, 0 if the platform or feature macros hide them
+    #if defined(__APPLE__)&&!defined(_POSIX_C_SOURCE)
+    return st->st_mtimespec.tv_nsec;
+    #elif (!defined(__APPLE__))&&(((defined(_POSIX_C_SOURCE))&&(_POSIX_C_SOURCE >= 200809L))||\
+        ((defined(_XOPEN_SOURCE))&&(_XOPEN_SOURCE >= 700)))
+    return st->st_mtim.tv_nsec;
+    #else
+    (void)st;
+    return 0; //whole seconds only, the read-back check still catches rewrites within one
+    #endif
+}
+static int lcfgVerify (FILE* cfg, struct lcfg_patch* chg, int num) {
+    //checks that the file still holds the located values, timestamps can miss quick rewrites
+    int max = 0, err = 0;
+    for (int i = 0; i < num; i++) if ((chg[i].loc->pos)&&(chg[i].loc->len > max)) max = chg[i].loc->len;
+    char* buf = malloc(max + 1);
+    if (!buf) return 1;
+    for (int i = 0; (i < num)&&(!err); i++) {
+        struct lcfg_loc* loc = chg[i].loc;
+        if (!loc->pos) continue;
+        if ((fseek(cfg, loc->pos - 1, SEEK_SET))||(fread(buf, 1, loc->len, cfg) != (size_t)loc->len)) {
+            err = 1;
+            break;
+        }
+        buf[loc->len] = '\0';
+        err = (lcfgHash(buf, lcfgLocated(chg[i].type, chg[i].id, buf, loc->len), 0) != loc->hash);
+    }
+    free(buf);
+    return err;
+}
+#endif
+static void lcfgLine (const char* txt, struct lcfg_read* rd) {
+    int type = 0, id = 0, skip = 0;
+    const char* val = NULL;
+    LCFG_CLOCK(beg)
+    if (rd->apply) {
+        LCFG_HOOK(parseBegin, txt)
+        LCFG_PROBE1(parse_begin, txt)
+    }
+    if ((rd->tok)&&(rd->tok->type >= 0)) { //looked up ahead of time by lcfgParallel
+        type = rd->tok->type;
+        id = rd->tok->id;
+        val = rd->tok->val;
+    } else if (lcfgSection(txt, rd->sec, &rd->slen)) {
+        skip = 1;
+    } else {
+        val = lcfgResolve(txt, rd->sec, rd->slen, &type, &id);
+    }
+    #ifdef LCONFIG_PATCH
+    if ((type == LCFG_INT)||(type == LCFG_STR)) lcfgLocate(type, id, rd->pos + (val - txt), val);
+    #endif
+    if ((type)&&(!rd->apply)) type = 0, skip = 1;
+    if ((type)&&(rd->sub)) { //skip config values outside the requested section
+        if (!lcfgWithin(lcfgName(type, id), rd->sub, rd->sublen)) type = 0, skip = 1;
+    }
+    LCFG_CLOCK(mid)
+    if (rd->apply) {
+        LCFG_HOOK(parseEnd, strlen(txt), mid - beg)
+        LCFG_PROBE2(parse_end, strlen(txt), mid - beg)
+    }
+    #ifdef LCONFIG_STATS
+    lcfg_pass.rbytes += strlen(txt); //before applying, which may shorten spans in place
+    #endif
+    if (type) {
+        LCFG_HOOK(applyBegin, type, id)
+        LCFG_PROBE2(apply_begin, type, id)
+    }
+    if ((type == LCFG_INT)||(type == LCFG_STR)) {
+        #ifdef LCONFIG_LAZY
+        if (!lcfgDefer(type, id, val, rd->pos + (val - txt), rd->line)) //decoded on first use
+        #endif
+        lcfgApply(type, id, val, rd->line);
+    } else if (type == LCFG_MAP) {
+        size_t len = strcspn(val, " \n"); //key, then value
+        int num, err = ((len)&&(val[len] == ' ')) ? lcfgParse(&val[len+1], &num) : -1;
+        if (err >= 0) lcfgMapSet(lcfgMap(id), val, len, num);
+        LCFG_STAT(invalid, err != 0)
+    }
+    LCFG_CLOCK(end)
+    if (type) {
+        LCFG_HOOK(applyEnd, type, id, end - mid)
+        LCFG_PROBE3(apply_end, type, id, end - mid)
+    }
+    #ifdef LCONFIG_STATS
+    lcfg_pass.tparse += mid - beg;
+    lcfg_pass.tapply += end - mid;
+    lcfg_pass.lines++;
+    unsigned* gen = (type == LCFG_INT) ? &lcfgInt(id)->gen : (type == LCFG_STR) ? &lcfgStr(id)->gen : NULL;
+    if (type == LCFG_MAP) {
+        lcfg_pass.matched++; //maps take one line per entry, so there are no duplicates
+    } else if (gen) {
+        lcfg_pass.matched++;
+        if (*gen == lcfg_gen) lcfg_pass.duplicate++;
+        *gen = lcfg_gen;
+    } else if ((!skip)&&(txt[0] != '#')&&(txt[strspn(txt, " \t\r\n")])) {
+        lcfg_pass.unknown++; //blank lines, # labels, section headers and skipped values are not counted
+    }
+    #else
+    (void)skip; //only counted with stats
+    #endif
+}
+static void lcfgApply (int type, int id, const char* val, int line) {
+    //decodes an int or string value read from the given line of the config file and stores it
+    if (type == LCFG_INT) {
+        struct lcfg_int* cfg = lcfgInt(id);
+        if (!cfg) return; //only for the compiler, matched IDs always exist
+        LCFG_WRITE(cfg)
+        int num = cfg->cur, err = lcfgParse(val, &num); //values without digits are left unchanged
+        int clamped = lcfgIntSet(cfg, num);
+        LCFG_STAT(invalid, err != 0)
+        if (err >= 0) { //the file only becomes the source if the value came from it
+            LCFG_PROV(LCFG_INT, id, LCONFIG_SFILE, line, clamped)
+        }
+    } else {
+        struct lcfg_str* cfg = lcfgStr(id);
+        if (!cfg) return;
+        LCFG_WRITE(cfg)
+        #ifdef LCONFIG_SPANS
+        int clamped = lcfgStrSpan(cfg, (char*)val); //lines come from lcfg_buf, which is writable
+        #else
+        int clamped = lcfgStrSet(cfg, val);
+        #endif
+        LCFG_PROV(LCFG_STR, id, LCONFIG_SFILE, line, clamped)
+    }
+    (void)line;
+}
+#ifdef LCONFIG_LAZY
+static int lcfgDefer (int type, int id, const char* val, size_t off, int line) {
+    //records where a template int or string is in the buffer being read instead of decoding it
+    //returns 0 if it has to be decoded right away (dynamic config values, files of 4 GB and more, and ints
+    //without digits, which leave the value and its provenance alone)
+    if ((off >= UINT32_MAX)||(id >= ((type == LCFG_INT) ? LCFG_NINTS : LCFG_NSTRS))) return 0;
+    if (type == LCFG_INT) {
+        const char* pos = val + strspn(val, " \t"); //same as lcfgParse returning -1
+        if ((*pos == '-')||(*pos == '+')) pos++;
+        if ((unsigned char)(*pos - '0') >= 10) return 0;
+    }
+    uint32_t* pend = (type == LCFG_INT) ? &lcfg_lazy_ints[id] : &lcfg_lazy_strs[id];
+    #if defined(__GNUC__)||defined(__clang__)
+    __atomic_store_n(pend, (uint32_t)off + 1, __ATOMIC_RELAXED); //getters only read it to take the lock
+    #else
+    *pend = (uint32_t)off + 1;
+    #endif
+    LCFG_PROV(type, id, LCONFIG_SFILE, line, 0) //clamping is only known once decoded
+    (void)line;
+    return 1;
 }
+static uint32_t lcfgPending (int type, int id) {
+    //returns the offset + 1 of a value still to be decoded, 0 if there is none
+    if ((id < 0)||(id >= ((type == LCFG_INT) ? LCFG_NINTS : (type == LCFG_STR) ? LCFG_NSTRS : 0))) return 0;
+    const uint32_t* pend = (type == LCFG_INT) ? &lcfg_lazy_ints[id] : &lcfg_lazy_strs[id];
+    #if defined(__GNUC__)||defined(__clang__)
+    return __atomic_load_n(pend, __ATOMIC_ACQUIRE); //pairs with the release in lcfgUnpend
+    #else
+    return *pend;
+    #endif
+}
+static void lcfgDecode (int type, int id) {
+    //decodes a pending value, waiting for a read in progress
+    if (lcfg_lazy_held) return; //called by a hook of the read, which has not yet published its buffer
+    pthread_mutex_lock(&lcfg_lazy_lock);
+    lcfgUnpend(type, id);
+    pthread_mutex_unlock(&lcfg_lazy_lock);
+}
+static void lcfgDecodeAll () {
+    //decodes every pending value
+    if (lcfg_lazy_held) return;
+    pthread_mutex_lock(&lcfg_lazy_lock);
+    for (int i = 0; i < LCFG_NINTS; i++) if (lcfg_lazy_ints[i]) lcfgUnpend(LCFG_INT, i);
+    for (int i = 0; i < LCFG_NSTRS; i++) if (lcfg_lazy_strs[i]) lcfgUnpend(LCFG_STR, i);
+    pthread_mutex_unlock(&lcfg_lazy_lock);
+}
+static void lcfgUnpend (int type, int id) {
+    //decodes a pending value from lcfg_buf, lcfg_lazy_lock must be held
+    uint32_t* pend = (type == LCFG_INT) ? &lcfg_lazy_ints[id] : &lcfg_lazy_strs[id];
+    if (!*pend) return; //decoded by another thread while this one waited for the lock
+    #ifdef LCONFIG_PROVENANCE
+    int line = *lcfgProv(type, id) >> 3; //as recorded by lcfgDefer
+    #else
+    int line = 0;
+    #endif
+    lcfgApply(type, id, &lcfg_buf[*pend - 1], line);
+    #if defined(__GNUC__)||defined(__clang__)
+    __atomic_store_n(pend, 0, __ATOMIC_RELEASE); //the value is stored before getters stop decoding it
+    #else
+    *pend = 0;
+    #endif
+}
+#endif
+static int lcfgSection (const char* txt, char* sec, size_t* slen) {
+    //remembers a section header in sec (LCONFIG_LMAX chars) with a trailing dot, returns 0 if not a header
+    size_t len = strcspn(txt, "]\n");
+    if ((txt[0] != '[')||(txt[len] != ']')||(len >= LCONFIG_LMAX)) return 0;
+    *slen = len - 1;
+    memcpy(sec, &txt[1], *slen);
+    if (*slen) sec[(*slen)++] = '.';
+    return 1;
+}
+static const char* lcfgResolve (const char* txt, char* sec, size_t slen, int* type, int* id) {
+    //same as lcfgFind, but tries the name qualified by the current section sec (see lcfgSection) first
+    size_t len = strcspn(txt, " \n");
+    if ((slen)&&(txt[len] == ' ')&&(slen + len < LCONFIG_LMAX)) {
+        memcpy(&sec[slen], txt, len);
+        const struct lcfg_key* key = lcfgKey(sec, slen + len, 0);
+        if (key) {
+            *type = key->type;
+            *id = key->id;
+            return &txt[len+1];
+        }
+    }
+    return lcfgFind(txt, type, id);
+}
+#ifdef LCONFIG_PARALLEL
+struct lcfg_chunk {
+    char* beg; //first line of the chunk
+    char* end; //end of the chunk, just after a newline or at the end of the buffer
+    int known; //1 if the section at beg is known, i.e. for the first chunk
+    struct lcfg_tok* toks; //lines of the chunk
+    size_t ntoks, cap; //lines found, allocated size of toks
+    int err; //1 if toks could not be allocated
+};
+#define LCFG_CHUNK (1 << 20) //smallest chunk worth a thread
+static int lcfgParallel (char* buf, size_t size, struct lcfg_read* rd) {
+    //looks up the lines of buf on several threads, then applies them in order
+    //returns 0 if all lines were applied, -1 if buf is too small or out of memory (buf is unchanged then)
+    int num = (size/LCFG_CHUNK < LCONFIG_PARALLEL) ? (int)(size/LCFG_CHUNK) : LCONFIG_PARALLEL;
+    if (num < 2) return -1;
+    struct lcfg_chunk cks[LCONFIG_PARALLEL];
+    pthread_t thr[LCONFIG_PARALLEL];
+    int started[LCONFIG_PARALLEL];
+    #ifndef LCONFIG_TABLES
+    if (!lcfg_indexed) lcfgIndex(); //before any thread looks up names
+    #endif
+    char* beg = buf;
+    for (int i = 0; i < num; i++) { //split at the first newline after each multiple of size/num
+        char* end = (i == num - 1) ? &buf[size] : &buf[size/num*(i + 1)];
+        if (end < beg) end = beg;
+        char* eol = memchr(end, '\n', &buf[size] - end);
+        end = eol ? eol + 1 : &buf[size];
+        struct lcfg_chunk ck = {beg, end, i == 0, NULL, 0, 0, 0};
+        cks[i] = ck;
+        beg = end;
+    }
+    for (int i = 1; i < num; i++) started[i] = (pthread_create(&thr[i], NULL, lcfgChunk, &cks[i]) == 0);
+    lcfgChunk(&cks[0]);
+    int err = cks[0].err;
+    for (int i = 1; i < num; i++) {
+        if (started[i]) pthread_join(thr[i], NULL);
+        else lcfgChunk(&cks[i]); //no thread available, do it here
+        err |= cks[i].err;
+    }
+    for (int i = 0; (!err)&&(i < num); i++) {
+        for (size_t j = 0; j < cks[i].ntoks; j++) {
+            struct lcfg_tok* tok = &cks[i].toks[j];
+            #ifdef LCONFIG_STATS
+            lcfg_pass.rbytes += (&tok->txt[tok->len] < &buf[size]); //count the newline replaced below
+            #endif
+            tok->txt[tok->len] = 0;
+            rd->pos = tok->txt - buf;
+            rd->line++;
+            rd->tok = tok;
+            lcfgLine(tok->txt, rd);
+        }
+    }
+    rd->tok = NULL;
+    for (int i = 0; i < num; i++) free(cks[i].toks);
+    return err ? -1 : 0;
+}
+static void* lcfgChunk (void* arg) {
+    //splits a chunk into lines and looks up their names, lines in front of its first section header stay
+    //unresolved unless the chunk starts the file, as their section depends on earlier chunks
+    struct lcfg_chunk* ck = arg;
+    char sec[LCONFIG_LMAX];
+    size_t slen = 0;
+    int known = ck->known;
+    for (char* txt = ck->beg; txt < ck->end; ) {
+        char* eol = memchr(txt, '\n', ck->end - txt);
+        if (!eol) eol = ck->end;
+        if (ck->ntoks == ck->cap) {
+            size_t cap = ck->cap ? ck->cap*2 : 4096;
+            struct lcfg_tok* toks = realloc(ck->toks, cap*sizeof(struct lcfg_tok));
+            if (!toks) {
+                ck->err = 1;
+                return NULL;
+            }
+            ck->toks = toks;
+            ck->cap = cap;
+        }
+        struct lcfg_tok tok = {txt, NULL, eol - txt, -1, 0};
+        if (lcfgSection(txt, sec, &slen)) known = 1; //headers are applied by lcfgLine, which tracks them too
+        else if (known) tok.val = lcfgResolve(txt, sec, slen, &tok.type, &tok.id);
+        ck->toks[ck->ntoks++] = tok;
+        txt = eol + 1;
+    }
+    return NULL;
+}
+#endif
+static void lcfgInfo (int type, int id, struct lconfig_info* info) {
+    //fills in the public description of a config value
+    struct lconfig_info out = {0};
+    out.type = type;
+    out.id = id;
+    LCFG_DECODE(type, id)
+    if (type == LCFG_INT) {
+        const struct lcfg_int* cfg = lcfgInt(id);
+        out.name = cfg->name;
+        out.min = cfg->min;
+        out.max = cfg->max;
+        out.def = cfg->def;
+        out.cur = cfg->cur;
+    } else if (type == LCFG_STR) {
+        const struct lcfg_str* cfg = lcfgStr(id);
+        out.name = cfg->name;
+        out.max = cfg->len;
+        out.sdef = cfg->def;
+        out.scur = lcfgStrCur(cfg);
+    } else {
+        const struct lcfg_map* cfg = lcfgMap(id);
+        out.name = cfg->name;
+        out.min = cfg->min;
+        out.max = cfg->max;
+        out.def = cfg->def;
+        out.cur = cfg->cnt;
+    }
+    out.len = strlen(out.name) - 1;
+    *info = out;
+}
+static int lcfgSorted () {
+    //builds the sorted name index if needed, returns its number of entries
+    //only names are looked at, so building it never decodes values (LCONFIG_LAZY)
+    int num = lconfigCount();
+    if (num == lcfg_nsorted) return num;
+    struct lcfg_key* keys = realloc(lcfg_sorted, (num + 1)*sizeof(struct lcfg_key));
+    if (!keys) return lcfg_nsorted;
+    for (int i = 0; i < num; i++) {
+        keys[i].type = (i < LCFG_NLAYS - 1) ? lcfg_lays[i].type : 0;
+        keys[i].id = (i < LCFG_NLAYS - 1) ? lcfg_lays[i].id : 0;
+        #ifdef LCONFIG_DYNAMIC
+        if (i >= LCFG_NLAYS - 1) {
+            keys[i].type = lcfg_dyn_lays[i - (LCFG_NLAYS - 1)].type;
+            keys[i].id = lcfg_dyn_lays[i - (LCFG_NLAYS - 1)].id;
+        }
+        #endif
+        keys[i].len = strlen(lcfgName(keys[i].type, keys[i].id));
+    }
+    qsort(keys, num, sizeof(struct lcfg_key), lcfgNameCompare);
+    lcfg_sorted = keys;
+    lcfg_nsorted = num;
+    return num;
+}
+static int lcfgNameCompare (const void* a, const void* b) {
+    //orders index entries by name, names end in a space so prefixes sort first
+    const struct lcfg_key* x = a;
+    const struct lcfg_key* y = b;
+    const char* xn = lcfgName(x->type, x->id);
+    const char* yn = lcfgName(y->type, y->id);
+    return strcmp(xn, yn);
+}
+static const char* lcfgFind (const char* txt, int* type, int* id) {
+    //finds the config value named at the start of txt, returns a pointer to its value or NULL
+    #ifndef LCONFIG_TABLES
+    if (!lcfg_indexed) lcfgIndex();
+    if (lcfg_indexed == 2) { //names with spaces cannot be split off, compare against every name instead
+        for (int i = 0; i < LCFG_NINTS; i++) {
+            if ((lcfg_ints[i].name)&&(strncmp(lcfg_ints[i].name, txt, strlen(lcfg_ints[i].name)) == 0)) {
+                *type = LCFG_INT;
+                *id = i;
+                return &txt[strlen(lcfg_ints[i].name)];
+            }
+        }
+        for (int i = 0; i < LCFG_NSTRS; i++) {
+            if ((lcfg_strs[i].name)&&(strncmp(lcfg_strs[i].name, txt, strlen(lcfg_strs[i].name)) == 0)) {
+                *type = LCFG_STR;
+                *id = i;
+                return &txt[strlen(lcfg_strs[i].name)];
+            }
+        }
+        #ifndef LCONFIG_DYNAMIC
+        *type = 0;
+        return NULL;
+        #endif
+    }
+    #endif
+    size_t len = strcspn(txt, " \n");
+    const struct lcfg_key* key = (txt[len] == ' ') ? lcfgKey(txt, len, 0) : NULL;
+    if (!key) {
+        *type = 0;
+        return NULL;
+    }
+    *type = key->type;
+    *id = key->id;
+    return &txt[len+1];
+}
+static const struct lcfg_key* lcfgKey (const char* name, size_t len, int type) {
+    //finds a config value by name (without trailing space) and type (0 for any) in O(1)
+    #ifdef LCONFIG_TABLES //perfect hash, exactly one candidate slot
+    uint32_t seed = lcfg_seeds[lcfgHash(name, len, 0)%(sizeof(lcfg_seeds)/sizeof(lcfg_seeds[0]))];
+    int slot = lcfgHash(name, len, seed)%(sizeof(lcfg_keys)/sizeof(lcfg_keys[0]));
+    const struct lcfg_key* key = &lcfg_keys[slot];
+    if (lcfgMatch(key, name, len, type)) return key;
+    #else //open addressing with linear probing, at most half full
+    if (!lcfg_indexed) lcfgIndex();
+    int num = sizeof(lcfg_keys)/sizeof(lcfg_keys[0]);
+    for (int i = lcfgHash(name, len, 0)%num; lcfg_keys[i].type; i = (i + 1)%num)
+        if (lcfgMatch(&lcfg_keys[i], name, len, type)) return &lcfg_keys[i];
+    #endif
+    #ifdef LCONFIG_DYNAMIC //same probing over registered names
+    if (lcfg_dyn_kcap) for (int i = lcfgHash(name, len, 0)&(lcfg_dyn_kcap - 1); lcfg_dyn_keys[i].type;
+        i = (i + 1)&(lcfg_dyn_kcap - 1))
+        if (lcfgMatch(&lcfg_dyn_keys[i], name, len, type)) return &lcfg_dyn_keys[i];
+    #endif
+    return NULL;
+}
+static int lcfgMatch (const struct lcfg_key* key, const char* name, size_t len, int type) {
+    //checks whether an index slot holds the given name and type, empty slots never match
+    if ((key->len != (int)len + 1)||(!key->type)||((type)&&(key->type != type))) return 0;
+    const char* str = lcfgName(key->type, key->id);
+    return memcmp(str, name, len) == 0;
+}
+static uint32_t lcfgHash (const char* key, size_t len, uint32_t seed) {
+    //FNV-1a with a final mix, lcfggen must use the exact same function
+    uint32_t h = 2166136261u ^ seed;
+    for (size_t i = 0; i < len; i++) h = (h ^ (unsigned char)key[i])*16777619u;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    return h;
+}
+#ifndef LCONFIG_TABLES
+static void lcfgIndex () {
+    //builds the name index, ints first so they win if an int and a str share a name
+    int num = sizeof(lcfg_keys)/sizeof(lcfg_keys[0]), spaced = 0;
+    for (int t = LCFG_INT; t <= LCFG_MAP; t++) {
+        int cnt = (t == LCFG_INT) ? LCFG_NINTS : (t == LCFG_STR) ? LCFG_NSTRS : LCFG_NMAPS;
+        for (int i = 0; i < cnt; i++) {
+            const char* name = (t == LCFG_INT) ? lcfg_ints[i].name :
+                (t == LCFG_STR) ? lcfg_strs[i].name : lcfg_maps[i].name;
+            if (!name) continue;
+            int len = strlen(name);
+            if (memchr(name, ' ', len - 1)) spaced = 1;
+            int slot = lcfgHash(name, len - 1, 0)%num;
+            while (lcfg_keys[slot].type) slot = (slot + 1)%num;
+            lcfg_keys[slot].type = t;
+            lcfg_keys[slot].id = i;
+            lcfg_keys[slot].len = len;
+        }
+    }
+    lcfg_indexed = spaced ? 2 : 1;
+}
+#endif
+#ifdef LCONFIG_DYNAMIC
+static int lcfgRegister (int type, const char* name, const void* cfg) {
+    //adds a config value with the given limits and default, growing storage and index as needed
+    size_t len = name ? strlen(name) : 0;
+    if ((!len)||(strcspn(name, " \n") != len)) return -1;
+    const struct lcfg_key* key = lcfgKey(name, len, 0);
+    if (key) { //only a dynamic value of the same type can be registered again
+        int first = (type == LCFG_INT) ? LCFG_NINTS : LCFG_NSTRS;
+        return ((key->type == type)&&(key->id >= first)) ? key->id : -1;
+    }
+    if (lcfg_dyn_nlays == lcfg_dyn_cap) { //arrays grow together, so one capacity covers all of them
+        int cap = lcfg_dyn_cap ? lcfg_dyn_cap*2 : 16;
+        void* ints = realloc(lcfg_dyn_ints, cap*sizeof(struct lcfg_int));
+        if (ints) lcfg_dyn_ints = ints;
+        void* strs = realloc(lcfg_dyn_strs, cap*sizeof(struct lcfg_str));
+        if (strs) lcfg_dyn_strs = strs;
+        void* lays = realloc(lcfg_dyn_lays, cap*sizeof(struct lcfg_key));
+        if (lays) lcfg_dyn_lays = lays;
+        #ifdef LCONFIG_PROVENANCE
+        void* pints = realloc(lcfg_dyn_pints, cap*sizeof(uint32_t));
+        if (pints) lcfg_dyn_pints = pints;
+        void* pstrs = realloc(lcfg_dyn_pstrs, cap*sizeof(uint32_t));
+        if (pstrs) lcfg_dyn_pstrs = pstrs;
+        if ((!pints)||(!pstrs)) return -1;
+        #endif
+        if ((!ints)||(!strs)||(!lays)) return -1;
+        lcfg_dyn_cap = cap;
+    }
+    if (2*(lcfg_dyn_nlays + 1) > lcfg_dyn_kcap) { //keep the index at most half full
+        int cap = lcfg_dyn_kcap ? lcfg_dyn_kcap*2 : 32;
+        struct lcfg_key* keys = calloc(cap, sizeof(struct lcfg_key));
+        if (!keys) return -1;
+        for (int i = 0; i < lcfg_dyn_kcap; i++) if (lcfg_dyn_keys[i].type) {
+            const char* str = lcfgName(lcfg_dyn_keys[i].type, lcfg_dyn_keys[i].id);
+            int slot = lcfgHash(str, lcfg_dyn_keys[i].len - 1, 0)&(cap - 1);
+            while (keys[slot].type) slot = (slot + 1)&(cap - 1);
+            keys[slot] = lcfg_dyn_keys[i];
+        }
+        free(lcfg_dyn_keys);
+        lcfg_dyn_keys = keys;
+        lcfg_dyn_kcap = cap;
+    }
+    char* str = malloc(len + 2); //name with trailing space, like template names
+    if (!str) return -1;
+    memcpy(str, name, len);
+    str[len] = ' ';
+    str[len+1] = 0;
+    struct lcfg_key ent = {type, 0, (int)len + 1};
+    if (type == LCFG_INT) {
+        const struct lcfg_int* src = cfg;
+        struct lcfg_int tmp = {.name = str, .min = src->min, .max = src->max,
+                               .def = src->def, .cur = src->def};
+        memcpy(&lcfg_dyn_ints[lcfg_dyn_nints], &tmp, sizeof(tmp));
+        #ifdef LCONFIG_PROVENANCE
+        lcfg_dyn_pints[lcfg_dyn_nints] = 0;
+        #endif
+        ent.id = LCFG_NINTS + lcfg_dyn_nints++;
+    } else {
+        const struct lcfg_str* src = cfg;
+        char* cur = malloc(src->len + 1);
+        char* def = malloc(src->len + 1);
+        if ((!cur)||(!def)) {
+            free(cur);
+            free(def);
+            free(str);
+            return -1;
+        }
+        size_t dlen = strcspn(src->def, "\n");
+        if (dlen > (size_t)src->len) dlen = src->len;
+        memcpy(def, src->def, dlen);
+        def[dlen] = 0;
+        strcpy(cur, def);
+        struct lcfg_str tmp = {.name = str, .len = src->len, .def = def, .cur = cur};
+        memcpy(&lcfg_dyn_strs[lcfg_dyn_nstrs], &tmp, sizeof(tmp));
+        #ifdef LCONFIG_PROVENANCE
+        lcfg_dyn_pstrs[lcfg_dyn_nstrs] = 0;
+        #endif
+        ent.id = LCFG_NSTRS + lcfg_dyn_nstrs++;
+    }
+    lcfg_dyn_lays[lcfg_dyn_nlays++] = ent;
+    int slot = lcfgHash(name, len, 0)&(lcfg_dyn_kcap - 1);
+    while (lcfg_dyn_keys[slot].type) slot = (slot + 1)&(lcfg_dyn_kcap - 1);
+    lcfg_dyn_keys[slot] = ent;
+    return ent.id;
+}
+#endif
+#ifdef LCONFIG_PROVENANCE
+static uint32_t* lcfgProv (int type, int id) {
+    //returns the provenance slot of an int or string, NULL if there is no such config value
+    if ((type == LCFG_INT)&&(lcfgInt(id))) {
+        #ifdef LCONFIG_DYNAMIC
+        if (id >= LCFG_NINTS) return &lcfg_dyn_pints[id - LCFG_NINTS];
+        #endif
+        return &lcfg_prov_ints[id];
+    }
+    if ((type == LCFG_STR)&&(lcfgStr(id))) {
+        #ifdef LCONFIG_DYNAMIC
+        if (id >= LCFG_NSTRS) return &lcfg_dyn_pstrs[id - LCFG_NSTRS];
+        #endif
+        return &lcfg_prov_strs[id];
+    }
+    return NULL;
+}
+#endif
+#ifdef LCONFIG_OVERRIDE
+static struct lcfg_ovr* lcfgOverride (int type, int id) {
+    //returns the innermost override of a config value on this thread, NULL if there is none
+    for (int i = lcfg_novrs - 1; i > 0; i--) //the bottom entry is always a scope marker
+        if ((lcfg_ovrs[i].id == id)&&(lcfg_ovrs[i].type == type)) return &lcfg_ovrs[i];
+    return NULL;
+}
+static struct lcfg_ovr* lcfgOverridePush (int type, int id) {
+    //pushes an override entry for a valid config value, NULL if impossible
+    if ((!lcfg_novrs)||(lcfg_novrs == LCONFIG_OVERRIDE)) return NULL;
+    struct lcfg_ovr* ovr = &lcfg_ovrs[lcfg_novrs++];
+    struct lcfg_ovr tmp = {type, id, 0, NULL};
+    *ovr = tmp;
+    return ovr;
+}
+#endif
+#ifdef LCONFIG_LOCK
+static int lcfgLock (int fd, int excl, int ms) {
+    //takes a shared or exclusive lock on the whole file, retrying for ms milliseconds (-1 forever)
+    //the lock is released when the file is closed, returns 0 on success
+    struct flock lck;
+    memset(&lck, 0, sizeof(lck));
+    lck.l_type = excl ? F_WRLCK : F_RDLCK;
+    lck.l_whence = SEEK_SET; //l_start and l_len of 0 cover the whole file
+    #ifdef F_OFD_SETLK
+    int cmd = (ms < 0) ? F_OFD_SETLKW : F_OFD_SETLK;
+    #else
+    int cmd = (ms < 0) ? F_SETLKW : F_SETLK;
+    #endif
+    for (long waited = 0, step = 1; ; waited += step, step = (step < 16) ? step*2 : 16) {
+        if (fcntl(fd, cmd, &lck) == 0) return 0;
+        if ((errno != EACCES)&&(errno != EAGAIN)&&(errno != EINTR)) return -1;
+        if ((ms >= 0)&&(waited >= ms)) return -1;
+        if (cmd == F_SETLKW) continue; //interrupted blocking wait, just retry
+        #ifdef F_OFD_SETLKW
+        if (cmd == F_OFD_SETLKW) continue;
+        #endif
+        if ((ms >= 0)&&(step > ms - waited)) step = ms - waited;
+        struct timespec ts = {0, step*1000000L};
+        nanosleep(&ts, NULL);
+    }
+}
+#endif
+#ifdef LCONFIG_PRELOAD
+static void* lcfgPreload (void* arg) {
+    //reads the config file on the preload thread, then wakes up every thread waiting for it
+    lcfg_preloader = 1;
+    int err = lconfigRead();
+    pthread_mutex_lock(&lcfg_preload_lock);
+    lcfg_preload_err = err;
+    lcfgPreloading(0);
+    pthread_cond_broadcast(&lcfg_preload_done);
+    pthread_mutex_unlock(&lcfg_preload_lock);
+    (void)arg;
+    return NULL;
+}
+static void lcfgPreloading (int val) {
+    //stores lcfg_preload, which LCFG_READY loads without holding lcfg_preload_lock
+    #if defined(__GNUC__)||defined(__clang__)
+    __atomic_store_n(&lcfg_preload, val, __ATOMIC_RELEASE);
+    #else
+    lcfg_preload = val;
+    #endif
+}
+#endif
+#ifdef LCONFIG_DURABLE
+static FILE* lcfgCreate (int ms, int level, int* lock, int* err) {
+    //opens the file lcfgWrite writes into, LCONFIG_PATH ".tmp" at LCONFIG_DFULL and the config file otherwise
+    //when locking, the config file is locked first (at LCONFIG_DFULL through *lock until lcfgCommit)
+    //returns NULL on failure, setting *err to 2 if the lock could not be taken in time
+    #ifdef LCONFIG_LOCK
+    if (level != LCONFIG_DFULL) { //lock before truncating, so readers never see a partial file
+        FILE* cfg = NULL;
+        int fd = open(LCONFIG_PATH, O_WRONLY|O_CREAT, 0666);
+        if (fd >= 0) {
+            if (lcfgLock(fd, 1, ms)) *err = 2;
+            else if ((ftruncate(fd, 0) == 0)&&((cfg = fdopen(fd, "w")))) fd = -1; //now owned by cfg
+            if (fd >= 0) close(fd);
+        }
+        return cfg;
+    }
+    for (int tries = 0; (tries < 3)&&(*lock < 0); tries++) { //retry if another writer replaced the file
+        int fd = open(LCONFIG_PATH, O_WRONLY|O_CREAT, 0666);
+        if (fd < 0) return NULL;
+        if (lcfgLock(fd, 1, ms)) {
+            close(fd);
+            *err = 2;
+            return NULL;
+        }
+        struct stat a, b;
+        int same = (fstat(fd, &a) == 0)&&(stat(LCONFIG_PATH, &b) == 0);
+        if ((same)&&(a.st_dev == b.st_dev)&&(a.st_ino == b.st_ino)) *lock = fd;
+        else close(fd);
+    }
+    if (*lock < 0) return NULL;
+    FILE* cfg = fopen(LCONFIG_PATH ".tmp", "w");
+    if (!cfg) {
+        close(*lock);
+        *lock = -1;
+    }
+    return cfg;
+    #else
+    (void)ms;
+    (void)lock;
+    (void)err;
+    return fopen((level == LCONFIG_DFULL) ? LCONFIG_PATH ".tmp" : LCONFIG_PATH, "w");
+    #endif
+}
+static int lcfgCommit (FILE* cfg, int level, int lock, int tmp) {
+    //syncs and closes a file written by lcfgWrite or a lconfigPatch rebuild, then releases the lock (if >= 0)
+    //if tmp is set the file is LCONFIG_PATH ".tmp", which is renamed over the config file
+    //returns 0 on success, 1 on failure, in which case a temporary file is removed again
+    int err = ((fflush(cfg))||(ferror(cfg))||(lcfgSyncFile(fileno(cfg), level)));
+    if (fclose(cfg)) err = 1;
+    if (tmp) {
+        if ((!err)&&(rename(LCONFIG_PATH ".tmp", LCONFIG_PATH))) err = 1;
+        if (err) remove(LCONFIG_PATH ".tmp");
+        else if (level == LCONFIG_DFULL) err = lcfgSyncDir();
+    }
+    if (lock >= 0) close(lock); //only now, so the next writer locks the new file
+    return err;
+}
+static int lcfgSyncFile (int fd, int level) {
+    //flushes a file to disk as the given level asks for, returns 0 on success
+    if ((level != LCONFIG_DDATA)&&(level != LCONFIG_DFULL)) return 0;
+    #ifdef LCONFIG_STATS
+    unsigned long long beg = lcfgNanos();
+    #endif
+    int err = ((level == LCONFIG_DDATA) ? fdatasync(fd) : fsync(fd)) != 0;
+    #ifdef LCONFIG_STATS
+    lcfgSyncStat(lcfgNanos() - beg);
+    #endif
+    return err;
+}
+static int lcfgSyncDir () {
+    //flushes the directory of the config file to disk, so renames and new files in it survive a crash
+    char dir[sizeof(LCONFIG_PATH) + 1] = ".";
+    const char* path = LCONFIG_PATH;
+    const char* end = strrchr(path, '/');
+    if (end) {
+        size_t len = (end == path) ? 1 : (size_t)(end - path); //"/" for files in the root
+        memcpy(dir, path, len);
+        dir[len] = 0;
+    }
+    int fd = open(dir, O_RDONLY);
+    if (fd < 0) return 1;
+    int err = lcfgSyncFile(fd, LCONFIG_DFULL);
+    close(fd);
+    return err;
+}
+#ifdef LCONFIG_STATS
+static void lcfgSyncStat (unsigned long long ns) {
+    //counts a single sync that took ns nanoseconds
+    lcfg_stats.lsync = ns;
+    lcfgStatAdd(&lcfg_stats.tsync, ns);
+    lcfgStatAdd(&lcfg_stats.syncs, 1);
+}
+#endif
+#endif
+#ifdef LCONFIG_PROFILE
+static int lcfgProfCompare (const void* a, const void* b) {
+    const struct lconfig_prof* x = a;
+    const struct lconfig_prof* y = b;
+    if (x->reads != y->reads) return (x->reads < y->reads) ? 1 : -1;
+    if (x->writes != y->writes) return (x->writes < y->writes) ? 1 : -1;
+    return (x->type != y->type) ? x->type - y->type : x->id - y->id;
+}
+#endif
+#ifdef LCONFIG_NUMA
+static const int* lcfgReplica () {
+    //sets the replica of the calling thread to the one of its node, making it if needed, NULL on failure
+    unsigned cpu = 0, node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, NULL) != 0) node = 0;
+    node %= LCONFIG_NUMA;
+    pthread_mutex_lock(&lcfg_numa_lock);
+    if (!lcfg_numa[node]) {
+        //fresh pages from mmap are placed on the node of the thread touching them first, which is this one,
+        //and replicas of different nodes never share a page (let alone a cache line)
+        size_t size = LCFG_NINTS*sizeof(int);
+        void* mem = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+        if (mem != MAP_FAILED) {
+            lcfg_numa[node] = mem;
+            for (int i = 0; i < LCFG_NINTS; i++) lcfg_numa[node][i] = lcfg_ints[i].cur;
+        }
+    }
+    lcfg_replica = lcfg_numa[node];
+    pthread_mutex_unlock(&lcfg_numa_lock);
+    lcfg_noreplica = !lcfg_replica;
+    return lcfg_replica;
+}
+static void lcfgReplicaSet (struct lcfg_int* cfg, int val) {
+    //stores a value, and for template ints also into every replica, so replicas never miss a store
+    uintptr_t off = (uintptr_t)cfg - (uintptr_t)lcfg_ints;
+    pthread_mutex_lock(&lcfg_numa_lock);
+    cfg->cur = val;
+    if (off < sizeof(lcfg_ints))
+        for (int i = 0; i < LCONFIG_NUMA; i++) if (lcfg_numa[i]) lcfg_numa[i][off/sizeof(*cfg)] = val;
+    pthread_mutex_unlock(&lcfg_numa_lock);
+}
+#ifdef LCONFIG_TABLES
+static void lcfgReplicaSync () {
+    //copies all template ints into every replica, after lconfigDefault stored them without lcfgReplicaSet
+    pthread_mutex_lock(&lcfg_numa_lock);
+    for (int n = 0; n < LCONFIG_NUMA; n++)
+        for (int i = 0; (lcfg_numa[n])&&(i < LCFG_NINTS); i++) lcfg_numa[n][i] = lcfg_ints[i].cur;
+    pthread_mutex_unlock(&lcfg_numa_lock);
+}
+#endif
+#endif
+#ifdef LCONFIG_CAPTURE
+static void lcfgCapture (int op, int id, int val, const char* str) {
+    //appends a record to the buffer of the calling thread, which is written out once full
+    struct lcfg_cap* cap = lcfg_cap;
+    if (!cap) { //first captured call of this thread, its buffer is kept for the lifetime of the program
+        if (!(cap = calloc(1, sizeof(struct lcfg_cap)))) return;
+        #if defined(__GNUC__)||defined(__clang__)
+        cap->thread = __atomic_fetch_add(&lcfg_capn, 1, __ATOMIC_RELAXED);
+        cap->next = __atomic_load_n(&lcfg_caps, __ATOMIC_RELAXED);
+        while (!__atomic_compare_exchange_n(&lcfg_caps, &cap->next, cap, 1,
+            __ATOMIC_RELEASE, __ATOMIC_RELAXED)); //on failure cap->next is the new head, try again
+        #else
+        cap->thread = lcfg_capn++;
+        cap->next = lcfg_caps;
+        lcfg_caps = cap;
+        #endif
+        lcfg_cap = cap;
+    }
+    size_t len = str ? strlen(str) : 0;
+    if (len > 65535) len = 65535;
+    struct lconfig_rec rec = {lcfgNanos() - lcfg_capt, cap->thread, op, (unsigned short)len, id, val};
+    if (cap->len + sizeof(rec) + len > sizeof(cap->buf)) lcfgCaptureFlush(cap);
+    if (sizeof(rec) + len > sizeof(cap->buf)) { //too long to buffer, written directly in one piece
+        char* tmp = malloc(sizeof(rec) + len);
+        if (!tmp) return;
+        memcpy(tmp, &rec, sizeof(rec));
+        if (len) memcpy(&tmp[sizeof(rec)], str, len);
+        if (lcfg_capf) fwrite(tmp, 1, sizeof(rec) + len, lcfg_capf);
+        free(tmp);
+        return;
+    }
+    memcpy(&cap->buf[cap->len], &rec, sizeof(rec));
+    if (len) memcpy(&cap->buf[cap->len + sizeof(rec)], str, len);
+    cap->len += sizeof(rec) + len;
+}
+static void lcfgCaptureFlush (struct lcfg_cap* cap) {
+    //writes out a thread buffer, stdio locks the file so buffers of different threads never interleave
+    if ((cap->len)&&(lcfg_capf)) fwrite(cap->buf, 1, cap->len, lcfg_capf);
+    cap->len = 0;
+}
+#endif
+#if defined(LCFG_TIMED)||defined(LCONFIG_CAPTURE)
+static unsigned long long lcfgNanos () {
+    #ifdef CLOCK_MONOTONIC
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec*1000000000u + ts.tv_nsec;
+    #else //coarse fallback where there is no monotonic clock
+    return (unsigned long long)clock()*(1000000000u/CLOCKS_PER_SEC);
+    #endif
+}
+#endif
+#if defined(LCONFIG_STATS)||defined(LCONFIG_PROFILE)
+static void lcfgStatAdd (unsigned long long* cnt, unsigned long long num) {
+    #if defined(__GNUC__)||defined(__clang__)
+    __atomic_fetch_add(cnt, num, __ATOMIC_RELAXED); //uncontended in practice, never a lock
+    #else
+    *cnt += num;
+    #endif
+}
+#endif
 
 #endif //LCONFIG_IMPLEMENTATION
\ No newline at end of file
@@ -0,0 +1,338 @@
+/*
+lcfgbench.c - Benchmark for lconfig using synthetic templates and config files
+
+To the extent possible under law, the author(s) have dedicated all copyright and related and neighboring
+rights to this software to the public domain worldwide. This software is distributed without any warranty.
+You should have received a copy of the CC0 Public Domain Dedication along with this software.
+If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+*/
+
+/*
+lcfgbench usage:
+    Since templates are fixed at compile time, benchmarking is done in two steps. First the generator is
+    built and run, which writes bench_template.h, bench_schema.txt and bench_config.txt into the current
+    directory. Then the benchmark itself is built against either the template or lcfggen tables and run.
+        cc -O2 -o lcfgbench tools/lcfgbench.c
+        ./lcfgbench -n 10000 -s 30 -k 8:24 -o shuffled
+        cc -O2 -I. -DLCFGBENCH_TEMPLATE='"bench_template.h"' -o lcfgbench_run tools/lcfgbench.c
+        ./lcfgbench_run -r 5
+    To benchmark tables instead of the template, run lcfggen on the schema and build with LCFGBENCH_TABLES:
+        lcfggen bench_schema.txt bench_ids.h bench_tables.h
+        cc -O2 -I. -DLCFGBENCH_TABLES='"bench_tables.h"' -o lcfgbench_run tools/lcfgbench.c
+
+lcfgbench generator options:
+    -n KEYS     number of config values (default 1000)
+    -s PCT      percentage of string values, the rest are ints (default 25)
+    -k MIN:MAX  name length range, uniformly distributed (default 8:24)
+    -l LEN      maximum length of string values (default 32)
+    -o ORDER    order of the config file: template, shuffled or unknown (default template)
+    -u PCT      with -o unknown, unknown keys added as a percentage of KEYS (default 10)
+    -x SEED     random seed (default 1)
+
+lcfgbench run options:
+    -r REPS     repetitions of each measurement, the fastest one is reported (default 5)
+    -g OPS      getter operations per repetition (default 10000000)
+    -i VALS     int values parsed per repetition (default 1000000)
+    Reports ns/line and MB/s for lconfigRead/lconfigWrite, ns/key for lconfigDefault, ns/op for the getters,
+    ns/value for the int parser next to atoi and strtol, and peak RSS. The config file is restored after the
+    write measurements. Int values mimic typical config files: mostly small counts and flags, then ports and
+    sizes, large limits, negative values and some hex masks (which atoi reads as 0, but still has to scan).
+*/
+
+//includes
+#define _POSIX_C_SOURCE 200809L //clock_gettime
+#include <stdlib.h> //random numbers and argument parsing
+#include <string.h> //string operations
+#include <stdio.h> //file output and reporting
+#include <stdint.h> //64-bit random state
+#include <time.h> //monotonic clock
+#include <sys/resource.h> //peak RSS
+
+//constants
+#define BENCH_CONFIG "bench_config.txt"
+
+#if defined(LCFGBENCH_TEMPLATE)||defined(LCFGBENCH_TABLES)
+//benchmark mode
+#ifdef LCFGBENCH_TEMPLATE
+    #include LCFGBENCH_TEMPLATE
+#else
+    #define LCONFIG_TABLES LCFGBENCH_TABLES
+#endif
+#define LCONFIG_PATH BENCH_CONFIG
+#define LCONFIG_STATIC
+#include "../lconfig.h"
+
+//function declarations
+static double benchNow();
+static double benchBest(double*, int);
+static char* benchInts(long);
+
+//entry point
+int main (int argc, char** argv) {
+    int reps = 5;
+    long ops = 10000000, vals = 1000000;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-r") == 0) reps = atoi(argv[i+1]);
+        else if (strcmp(argv[i], "-g") == 0) ops = atol(argv[i+1]);
+        else if (strcmp(argv[i], "-i") == 0) vals = atol(argv[i+1]);
+    }
+    if (reps < 1) reps = 1;
+    if (ops < 1) ops = 1;
+    if (vals < 1) vals = 1;
+    //keep original file so it can be restored after writing
+    FILE* cfg = fopen(BENCH_CONFIG, "rb");
+    if (!cfg) {
+        fprintf(stderr, "%s not found, run the generator first\n", BENCH_CONFIG);
+        return 1;
+    }
+    fseek(cfg, 0, SEEK_END);
+    long size = ftell(cfg);
+    rewind(cfg);
+    char* orig = malloc(size + 1);
+    if ((!orig)||(fread(orig, 1, size, cfg) != (size_t)size)) return 1;
+    fclose(cfg);
+    long lines = 0;
+    for (long i = 0; i < size; i++) if (orig[i] == '\n') lines++;
+    int nints = sizeof(lcfg_ints)/sizeof(lcfg_ints[0]), nstrs = sizeof(lcfg_strs)/sizeof(lcfg_strs[0]);
+    printf("keys %d ints, %d strs, file %ld lines, %ld bytes\n", nints, nstrs, lines, size);
+    //read, default and write
+    double* t = malloc(reps*sizeof(double));
+    if (!t) return 1;
+    for (int r = 0; r < reps; r++) {
+        double s = benchNow();
+        if (lconfigRead()) return 1;
+        t[r] = benchNow() - s;
+    }
+    double best = benchBest(t, reps);
+    printf("lconfigRead      %10.1f ns/line %10.1f MB/s\n", best*1e9/lines, size/best/1e6);
+    for (int r = 0; r < reps; r++) {
+        double s = benchNow();
+        lconfigDefault();
+        t[r] = benchNow() - s;
+    }
+    printf("lconfigDefault   %10.1f ns/key\n", benchBest(t, reps)*1e9/(nints + nstrs));
+    lconfigRead();
+    long wsize = 0, wlines = 0;
+    for (int r = 0; r < reps; r++) {
+        double s = benchNow();
+        if (lconfigWrite()) return 1;
+        t[r] = benchNow() - s;
+    }
+    best = benchBest(t, reps);
+    if ((cfg = fopen(BENCH_CONFIG, "rb"))) {
+        for (int c; (c = fgetc(cfg)) != EOF; wsize++) if (c == '\n') wlines++;
+        fclose(cfg);
+    }
+    if (wlines) printf("lconfigWrite     %10.1f ns/line %10.1f MB/s\n", best*1e9/wlines, wsize/best/1e6);
+    if ((cfg = fopen(BENCH_CONFIG, "wb"))) {
+        fwrite(orig, 1, size, cfg);
+        fclose(cfg);
+    }
+    //getters over a random ID sequence, so the access pattern is not trivially predictable
+    int* ids = malloc(4096*sizeof(int));
+    if (!ids) return 1;
+    srand(1);
+    long sum = 0;
+    for (int i = 0; i < 4096; i++) ids[i] = rand()%nints;
+    for (int r = 0; r < reps; r++) {
+        double s = benchNow();
+        for (long i = 0; i < ops; i++) sum += lconfigGetInt(ids[i&4095]);
+        t[r] = benchNow() - s;
+    }
+    printf("lconfigGetInt    %10.2f ns/op\n", benchBest(t, reps)*1e9/ops);
+    for (int i = 0; i < 4096; i++) ids[i] = rand()%nstrs;
+    for (int r = 0; r < reps; r++) {
+        double s = benchNow();
+        for (long i = 0; i < ops; i++) {
+            const char* str = lconfigGetString(ids[i&4095]);
+            sum += str ? str[0] : 0;
+        }
+        t[r] = benchNow() - s;
+    }
+    printf("lconfigGetString %10.2f ns/op\n", benchBest(t, reps)*1e9/ops);
+    for (int r = 0; r < reps; r++) {
+        double s = benchNow();
+        for (long i = 0; i < ops/16; i++) lconfigSetInt(ids[i&4095]%nints, (int)i);
+        t[r] = benchNow() - s;
+    }
+    printf("lconfigSetInt    %10.2f ns/op\n", benchBest(t, reps)*1e9/(ops/16 ? ops/16 : 1));
+    for (int r = 0; r < reps; r++) {
+        double s = benchNow();
+        for (long i = 0; i < ops/16; i++) lconfigSetString(ids[i&4095], (i&1) ? "benchmark" : "lconfig");
+        t[r] = benchNow() - s;
+    }
+    printf("lconfigSetString %10.2f ns/op\n", benchBest(t, reps)*1e9/(ops/16 ? ops/16 : 1));
+    //int parsing, each value is a line of its own like in the config file
+    char* ints = benchInts(vals);
+    if (!ints) return 1;
+    for (int r = 0; r < reps; r++) {
+        double s = benchNow();
+        for (char* pos = ints; *pos; pos += strcspn(pos, "\n") + 1) {
+            int num = 0;
+            sum += lcfgParse(pos, &num) + num;
+        }
+        t[r] = benchNow() - s;
+    }
+    printf("lcfgParse        %10.2f ns/value\n", benchBest(t, reps)*1e9/vals);
+    for (int r = 0; r < reps; r++) {
+        double s = benchNow();
+        for (char* pos = ints; *pos; pos += strcspn(pos, "\n") + 1) sum += atoi(pos);
+        t[r] = benchNow() - s;
+    }
+    printf("atoi             %10.2f ns/value\n", benchBest(t, reps)*1e9/vals);
+    for (int r = 0; r < reps; r++) {
+        double s = benchNow();
+        for (char* pos = ints; *pos; pos += strcspn(pos, "\n") + 1) sum += strtol(pos, NULL, 0);
+        t[r] = benchNow() - s;
+    }
+    printf("strtol           %10.2f ns/value\n", benchBest(t, reps)*1e9/vals);
+    struct rusage use;
+    getrusage(RUSAGE_SELF, &use);
+    printf("peak RSS         %10ld KB\n", use.ru_maxrss);
+    return sum == 42; //keeps getter loops from being optimized out
+}
+
+//internal functions
+static double benchNow () {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+static double benchBest (double* t, int reps) {
+    double best = t[0];
+    for (int r = 1; r < reps; r++) if (t[r] < best) best = t[r];
+    return best;
+}
+static char* benchInts (long vals) {
+    //newline separated int values, with the distribution described in the usage
+    char* ints = malloc(vals*16 + 1);
+    if (!ints) return NULL;
+    char* pos = ints;
+    srand(2);
+    for (long i = 0; i < vals; i++) {
+        int pick = rand()%100;
+        if (pick < 50) pos += sprintf(pos, "%d\n", rand()%100);
+        else if (pick < 75) pos += sprintf(pos, "%d\n", rand()%65536);
+        else if (pick < 85) pos += sprintf(pos, "%d\n", rand()%1000000000);
+        else if (pick < 95) pos += sprintf(pos, "%d\n", -1 - rand()%1000);
+        else pos += sprintf(pos, "0x%X\n", (unsigned)rand()&0xFFFFFF);
+    }
+    *pos = '\0';
+    return ints;
+}
+
+#else
+//generator mode
+
+//structs
+struct bench_key {
+    int type; //1 for int, 2 for str
+    int id; //ID within its data type
+    char name[64]; //name in config file
+};
+
+//function declarations
+static unsigned long benchRand();
+static void benchValue(char*, const struct bench_key*, int);
+
+//globals
+static uint64_t bench_seed = 1;
+
+//entry point
+int main (int argc, char** argv) {
+    int num = 1000, spct = 25, kmin = 8, kmax = 24, slen = 32, upct = 10;
+    const char* order = "template";
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-n") == 0) num = atoi(argv[i+1]);
+        else if (strcmp(argv[i], "-s") == 0) spct = atoi(argv[i+1]);
+        else if (strcmp(argv[i], "-k") == 0) sscanf(argv[i+1], "%d:%d", &kmin, &kmax);
+        else if (strcmp(argv[i], "-l") == 0) slen = atoi(argv[i+1]);
+        else if (strcmp(argv[i], "-o") == 0) order = argv[i+1];
+        else if (strcmp(argv[i], "-u") == 0) upct = atoi(argv[i+1]);
+        else if (strcmp(argv[i], "-x") == 0) bench_seed = strtoull(argv[i+1], NULL, 10) | 1;
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (kmin < 8) kmin = 8; //room for the unique numeric prefix
+    if (kmax > 63) kmax = 63;
+    if (kmax < kmin) kmax = kmin;
+    if (slen < 1) slen = 1;
+    if (strcmp(order, "unknown") != 0) upct = 0;
+    int unk = (int)((long)num*upct/100);
+    struct bench_key* keys = malloc((num + unk)*sizeof(struct bench_key));
+    if (!keys) return 1;
+    //names are unique through their numeric prefix and padded with random letters
+    int nints = 0, nstrs = 0;
+    for (int i = 0; i < num + unk; i++) {
+        struct bench_key* key = &keys[i];
+        key->type = (i >= num) ? 0 : ((int)(benchRand()%100) < spct) ? 2 : 1;
+        key->id = (key->type == 2) ? nstrs++ : (key->type == 1) ? nints++ : -1;
+        int len = kmin + (int)(benchRand()%(kmax - kmin + 1));
+        int pre = sprintf(key->name, "%c%d_", (i >= num) ? 'u' : 'k', i);
+        for (int c = pre; c < len; c++) key->name[c] = 'a' + benchRand()%26;
+        key->name[(len > pre) ? len : pre] = 0;
+    }
+    //template header and lcfggen schema in template order, with a label every 64 entries
+    FILE* tpl = fopen("bench_template.h", "w");
+    FILE* sch = fopen("bench_schema.txt", "w");
+    if ((!tpl)||(!sch)) return 1;
+    fprintf(tpl, "//generated by lcfgbench\n#define LCONFIG_TEMPLATE \\\n");
+    for (int i = 0; i < num; i++) {
+        if (i%64 == 0) {
+            fprintf(tpl, "    LCONFIG_LINE(\"#section %d\") \\\n", i/64);
+            fprintf(sch, "line #section %d\n", i/64);
+        }
+        if (keys[i].type == 1) {
+            fprintf(tpl, "    LCONFIG_INT(%d, \"%s\", -1000000, 1000000, 0) \\\n", keys[i].id, keys[i].name);
+            fprintf(sch, "int I%d %s -1000000 1000000 0\n", keys[i].id, keys[i].name);
+        } else {
+            fprintf(tpl, "    LCONFIG_STR(%d, \"%s\", %d, \"\") \\\n", keys[i].id, keys[i].name, slen);
+            fprintf(sch, "str S%d %s %d \n", keys[i].id, keys[i].name, slen);
+        }
+    }
+    fprintf(tpl, "\n");
+    fclose(tpl);
+    fclose(sch);
+    //config file in the requested order
+    if (strcmp(order, "template") != 0) for (int i = num + unk - 1; i > 0; i--) {
+        int j = (int)(benchRand()%(i + 1));
+        struct bench_key tmp = keys[i];
+        keys[i] = keys[j];
+        keys[j] = tmp;
+    }
+    FILE* cfg = fopen(BENCH_CONFIG, "w");
+    if (!cfg) return 1;
+    char val[256];
+    for (int i = 0; i < num + unk; i++) {
+        benchValue(val, &keys[i], slen);
+        fprintf(cfg, "%s %s\n", keys[i].name, val);
+    }
+    fclose(cfg);
+    printf("generated %d ints, %d strs, %d unknown keys (%s order)\n", nints, nstrs, unk, order);
+    return 0;
+}
+
+//internal functions
+static unsigned long benchRand () {
+    //xorshift, deterministic across platforms for a given seed
+    bench_seed ^= bench_seed << 13;
+    bench_seed ^= bench_seed >> 7;
+    bench_seed ^= bench_seed << 17;
+    return (unsigned long)(bench_seed & 0xffffffffu);
+}
+static void benchValue (char* val, const struct bench_key* key, int slen) {
+    //ints spread over several magnitudes, strings of random length up to slen
+    if (key->type != 2) {
+        long mag = 1;
+        for (int d = benchRand()%7; d > 0; d--) mag *= 10;
+        sprintf(val, "%ld", (long)(benchRand()%(mag*10)) - mag*5);
+    } else {
+        int len = (slen > 255 ? 255 : slen);
+        len = (int)(benchRand()%(len + 1));
+        for (int c = 0; c < len; c++) val[c] = 'a' + benchRand()%26;
+        val[len] = 0;
+    }
+}
+#endif
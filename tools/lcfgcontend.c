@@ -0,0 +1,253 @@
+/*
+lcfgcontend.c - Multi-threaded contention benchmark for lconfig getters, sets and reloads
+
+To the extent possible under law, the author(s) have dedicated all copyright and related and neighboring
+rights to this software to the public domain worldwide. This software is distributed without any warranty.
+You should have received a copy of the CC0 Public Domain Dedication along with this software.
+If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+*/
+
+/*
+lcfgcontend usage:
+    cc -O2 -pthread -o lcfgcontend tools/lcfgcontend.c
+    ./lcfgcontend -t 64 -d 2 -s 10000 -l 20
+    Runs reader threads hammering lconfigGetInt/lconfigGetString while a single writer thread calls
+    lconfigSetInt/lconfigSetString and reloads the config file with lconfigRead at the given rates. This is
+    repeated for 1, 2, 4, ... up to the given number of readers, reporting reader latency percentiles,
+    total throughput and throughput per reader (scaling), and the number of torn reads seen.
+
+lcfgcontend options:
+    -t THREADS  maximum number of reader threads (default 4)
+    -d SECS     duration of each step (default 1)
+    -s RATE     sets per second done by the writer, 0 to disable (default 1000)
+    -l RATE     reloads per second done by the writer, 0 to disable (default 10)
+    -m PCT      percentage of reads that are strings (default 20)
+    -b BATCH    calls timed together per latency sample, larger batches hide timer overhead (default 1)
+
+lcfgcontend torn reads:
+    Every string written (by set or reload) is self-checking: it consists of a single repeated letter whose
+    length is determined by that letter. A reader seeing anything else has observed a partially applied
+    update, which is counted as a torn read. Ints are single aligned words that cannot tear, so they are
+    read but not checked.
+*/
+
+//includes
+#define _POSIX_C_SOURCE 200809L //clock_gettime, nanosleep
+#include <pthread.h> //reader and writer threads
+#include <stdlib.h> //memory and argument parsing
+#include <string.h> //string operations
+#include <stdint.h> //64-bit random state
+#include <stdio.h> //config file and reporting
+#include <time.h> //monotonic clock
+
+//template
+#define CONTEND_INTS 64
+#define CONTEND_STRS 16
+#define CONTEND_LEN 40
+#define CONTEND_SAMPLES (1 << 20) //latency samples kept per reader
+#define LCONFIG_PATH "contend_config.txt"
+#define LCONFIG_TEMPLATE \
+    LCONFIG_INT(0, "i00", 0, 2147483647, 0) LCONFIG_INT(1, "i01", 0, 2147483647, 0) \
+    LCONFIG_INT(2, "i02", 0, 2147483647, 0) LCONFIG_INT(3, "i03", 0, 2147483647, 0) \
+    LCONFIG_INT(4, "i04", 0, 2147483647, 0) LCONFIG_INT(5, "i05", 0, 2147483647, 0) \
+    LCONFIG_INT(6, "i06", 0, 2147483647, 0) LCONFIG_INT(7, "i07", 0, 2147483647, 0) \
+    LCONFIG_INT(8, "i08", 0, 2147483647, 0) LCONFIG_INT(9, "i09", 0, 2147483647, 0) \
+    LCONFIG_INT(10, "i10", 0, 2147483647, 0) LCONFIG_INT(11, "i11", 0, 2147483647, 0) \
+    LCONFIG_INT(12, "i12", 0, 2147483647, 0) LCONFIG_INT(13, "i13", 0, 2147483647, 0) \
+    LCONFIG_INT(14, "i14", 0, 2147483647, 0) LCONFIG_INT(15, "i15", 0, 2147483647, 0) \
+    LCONFIG_INT(16, "i16", 0, 2147483647, 0) LCONFIG_INT(17, "i17", 0, 2147483647, 0) \
+    LCONFIG_INT(18, "i18", 0, 2147483647, 0) LCONFIG_INT(19, "i19", 0, 2147483647, 0) \
+    LCONFIG_INT(20, "i20", 0, 2147483647, 0) LCONFIG_INT(21, "i21", 0, 2147483647, 0) \
+    LCONFIG_INT(22, "i22", 0, 2147483647, 0) LCONFIG_INT(23, "i23", 0, 2147483647, 0) \
+    LCONFIG_INT(24, "i24", 0, 2147483647, 0) LCONFIG_INT(25, "i25", 0, 2147483647, 0) \
+    LCONFIG_INT(26, "i26", 0, 2147483647, 0) LCONFIG_INT(27, "i27", 0, 2147483647, 0) \
+    LCONFIG_INT(28, "i28", 0, 2147483647, 0) LCONFIG_INT(29, "i29", 0, 2147483647, 0) \
+    LCONFIG_INT(30, "i30", 0, 2147483647, 0) LCONFIG_INT(31, "i31", 0, 2147483647, 0) \
+    LCONFIG_INT(32, "i32", 0, 2147483647, 0) LCONFIG_INT(33, "i33", 0, 2147483647, 0) \
+    LCONFIG_INT(34, "i34", 0, 2147483647, 0) LCONFIG_INT(35, "i35", 0, 2147483647, 0) \
+    LCONFIG_INT(36, "i36", 0, 2147483647, 0) LCONFIG_INT(37, "i37", 0, 2147483647, 0) \
+    LCONFIG_INT(38, "i38", 0, 2147483647, 0) LCONFIG_INT(39, "i39", 0, 2147483647, 0) \
+    LCONFIG_INT(40, "i40", 0, 2147483647, 0) LCONFIG_INT(41, "i41", 0, 2147483647, 0) \
+    LCONFIG_INT(42, "i42", 0, 2147483647, 0) LCONFIG_INT(43, "i43", 0, 2147483647, 0) \
+    LCONFIG_INT(44, "i44", 0, 2147483647, 0) LCONFIG_INT(45, "i45", 0, 2147483647, 0) \
+    LCONFIG_INT(46, "i46", 0, 2147483647, 0) LCONFIG_INT(47, "i47", 0, 2147483647, 0) \
+    LCONFIG_INT(48, "i48", 0, 2147483647, 0) LCONFIG_INT(49, "i49", 0, 2147483647, 0) \
+    LCONFIG_INT(50, "i50", 0, 2147483647, 0) LCONFIG_INT(51, "i51", 0, 2147483647, 0) \
+    LCONFIG_INT(52, "i52", 0, 2147483647, 0) LCONFIG_INT(53, "i53", 0, 2147483647, 0) \
+    LCONFIG_INT(54, "i54", 0, 2147483647, 0) LCONFIG_INT(55, "i55", 0, 2147483647, 0) \
+    LCONFIG_INT(56, "i56", 0, 2147483647, 0) LCONFIG_INT(57, "i57", 0, 2147483647, 0) \
+    LCONFIG_INT(58, "i58", 0, 2147483647, 0) LCONFIG_INT(59, "i59", 0, 2147483647, 0) \
+    LCONFIG_INT(60, "i60", 0, 2147483647, 0) LCONFIG_INT(61, "i61", 0, 2147483647, 0) \
+    LCONFIG_INT(62, "i62", 0, 2147483647, 0) LCONFIG_INT(63, "i63", 0, 2147483647, 0) \
+    LCONFIG_STR(0, "s00", CONTEND_LEN, "") LCONFIG_STR(1, "s01", CONTEND_LEN, "") \
+    LCONFIG_STR(2, "s02", CONTEND_LEN, "") LCONFIG_STR(3, "s03", CONTEND_LEN, "") \
+    LCONFIG_STR(4, "s04", CONTEND_LEN, "") LCONFIG_STR(5, "s05", CONTEND_LEN, "") \
+    LCONFIG_STR(6, "s06", CONTEND_LEN, "") LCONFIG_STR(7, "s07", CONTEND_LEN, "") \
+    LCONFIG_STR(8, "s08", CONTEND_LEN, "") LCONFIG_STR(9, "s09", CONTEND_LEN, "") \
+    LCONFIG_STR(10, "s10", CONTEND_LEN, "") LCONFIG_STR(11, "s11", CONTEND_LEN, "") \
+    LCONFIG_STR(12, "s12", CONTEND_LEN, "") LCONFIG_STR(13, "s13", CONTEND_LEN, "") \
+    LCONFIG_STR(14, "s14", CONTEND_LEN, "") LCONFIG_STR(15, "s15", CONTEND_LEN, "")
+#define LCONFIG_IMPLEMENTATION
+#include "../lconfig.h"
+
+//structs
+struct contend_reader {
+    pthread_t thread;
+    uint64_t seed; //xorshift state for picking IDs
+    long ops; //calls done
+    long torn; //torn reads seen
+    unsigned sum; //ints read, summed so the gets cannot be optimized out
+    long nsamp; //latency samples taken
+    float* samp; //latency samples in ns per call, ring buffer
+};
+
+//function declarations
+static void* contendRead(void*);
+static void* contendWrite(void*);
+static double contendNow();
+static void contendFill(char*, int);
+static int contendCheckStr(const char*);
+static int contendCompare(const void*, const void*);
+
+//globals
+static volatile int contend_stop; //set when a step is over
+static int contend_spct = 20, contend_batch = 1;
+static double contend_sets = 1000, contend_loads = 10;
+static long contend_wsets, contend_wloads; //writer operations done in the current step
+
+//entry point
+int main (int argc, char** argv) {
+    int threads = 4;
+    double secs = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-t") == 0) threads = atoi(argv[i+1]);
+        else if (strcmp(argv[i], "-d") == 0) secs = atof(argv[i+1]);
+        else if (strcmp(argv[i], "-s") == 0) contend_sets = atof(argv[i+1]);
+        else if (strcmp(argv[i], "-l") == 0) contend_loads = atof(argv[i+1]);
+        else if (strcmp(argv[i], "-m") == 0) contend_spct = atoi(argv[i+1]);
+        else if (strcmp(argv[i], "-b") == 0) contend_batch = atoi(argv[i+1]);
+        else {
+            fprintf(stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+    }
+    if (threads < 1) threads = 1;
+    if (contend_batch < 1) contend_batch = 1;
+    //config file with self-checking values for the reloads
+    FILE* cfg = fopen(LCONFIG_PATH, "w");
+    if (!cfg) return 1;
+    char str[CONTEND_LEN + 1];
+    for (int i = 0; i < CONTEND_INTS; i++) fprintf(cfg, "i%02d %d\n", i, 'z');
+    for (int i = 0; i < CONTEND_STRS; i++) contendFill(str, 'z'), fprintf(cfg, "s%02d %s\n", i, str);
+    fclose(cfg);
+    for (int i = 0; i < CONTEND_STRS; i++) contendFill(str, 'a'), lconfigSetString(i, str);
+    for (int i = 0; i < CONTEND_INTS; i++) lconfigSetInt(i, 0x6161);
+    struct contend_reader* rds = calloc(threads, sizeof(struct contend_reader));
+    float* all = malloc((size_t)threads*CONTEND_SAMPLES*sizeof(float));
+    if ((!rds)||(!all)) return 1;
+    for (int i = 0; i < threads; i++) rds[i].samp = &all[(size_t)i*CONTEND_SAMPLES];
+    printf("readers      p50 ns   p99 ns  p999 ns    Mops/s  Mops/s/rd  torn  sets  reloads\n");
+    double base = 0;
+    for (int n = 1; n <= threads; n = ((n < threads)&&(n*2 > threads)) ? threads : n*2) {
+        contend_stop = 0;
+        contend_wsets = contend_wloads = 0;
+        pthread_t writer;
+        for (int i = 0; i < n; i++) {
+            rds[i].seed = 0x9e3779b9u*(uint64_t)(i + 1);
+            rds[i].ops = rds[i].torn = rds[i].nsamp = 0;
+            pthread_create(&rds[i].thread, NULL, contendRead, &rds[i]);
+        }
+        pthread_create(&writer, NULL, contendWrite, NULL);
+        struct timespec ts = {(time_t)secs, (long)((secs - (time_t)secs)*1e9)};
+        nanosleep(&ts, NULL);
+        contend_stop = 1;
+        pthread_join(writer, NULL);
+        long ops = 0, torn = 0, nsamp = 0;
+        for (int i = 0; i < n; i++) {
+            pthread_join(rds[i].thread, NULL);
+            ops += rds[i].ops;
+            torn += rds[i].torn;
+            long cnt = (rds[i].nsamp < CONTEND_SAMPLES) ? rds[i].nsamp : CONTEND_SAMPLES;
+            memmove(&all[nsamp], rds[i].samp, cnt*sizeof(float)); //compact samples for sorting
+            nsamp += cnt;
+        }
+        qsort(all, nsamp, sizeof(float), contendCompare);
+        double mops = ops/secs/1e6;
+        if (n == 1) base = mops;
+        printf("%7d %9.1f %8.1f %8.1f %9.2f %10.2f %5ld %5ld %8ld  (%.2fx)\n", n,
+            nsamp ? all[nsamp/2] : 0, nsamp ? all[nsamp*99/100] : 0, nsamp ? all[nsamp*999/1000] : 0,
+            mops, mops/n, torn, contend_wsets, contend_wloads, base ? mops/base : 0);
+    }
+    remove(LCONFIG_PATH);
+    return 0;
+}
+
+//internal functions
+static void* contendRead (void* arg) {
+    struct contend_reader* rd = arg;
+    while (!contend_stop) {
+        double s = contendNow();
+        for (int b = 0; b < contend_batch; b++) {
+            rd->seed ^= rd->seed << 13;
+            rd->seed ^= rd->seed >> 7;
+            rd->seed ^= rd->seed << 17;
+            if ((int)(rd->seed%100) < contend_spct) {
+                rd->torn += !contendCheckStr(lconfigGetString((rd->seed >> 8)%CONTEND_STRS));
+            } else {
+                rd->sum += lconfigGetInt((rd->seed >> 8)%CONTEND_INTS);
+            }
+        }
+        rd->samp[rd->nsamp++%CONTEND_SAMPLES] = (float)((contendNow() - s)*1e9/contend_batch);
+        rd->ops += contend_batch;
+    }
+    return NULL;
+}
+static void* contendWrite (void* arg) {
+    //paces sets and reloads against the clock, sleeping briefly when nothing is due
+    (void)arg;
+    char str[CONTEND_LEN + 1];
+    double start = contendNow();
+    while (!contend_stop) {
+        double now = contendNow() - start;
+        int busy = 0;
+        if (contend_wsets < now*contend_sets) {
+            int c = 'a' + contend_wsets%25;
+            contendFill(str, c);
+            lconfigSetString(contend_wsets%CONTEND_STRS, str);
+            lconfigSetInt(contend_wsets%CONTEND_INTS, c);
+            contend_wsets++;
+            busy = 1;
+        }
+        if (contend_wloads < now*contend_loads) {
+            lconfigRead();
+            contend_wloads++;
+            busy = 1;
+        }
+        if (!busy) {
+            struct timespec ts = {0, 20000};
+            nanosleep(&ts, NULL);
+        }
+    }
+    return NULL;
+}
+static double contendNow () {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+static void contendFill (char* str, int c) {
+    //length depends on the letter so a torn mix of two writes is detectable
+    int len = 8 + (c - 'a')%(CONTEND_LEN - 7);
+    memset(str, c, len);
+    str[len] = 0;
+}
+static int contendCheckStr (const char* str) {
+    if ((!str)||(str[0] < 'a')||(str[0] > 'z')) return 0;
+    char exp[CONTEND_LEN + 1];
+    contendFill(exp, (unsigned char)str[0]);
+    return strcmp(exp, str) == 0;
+}
+static int contendCompare (const void* a, const void* b) {
+    float x = *(const float*)a, y = *(const float*)b;
+    return (x > y) - (x < y);
+}
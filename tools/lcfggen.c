@@ -0,0 +1,295 @@
+/*
+lcfggen.c - Table generator for lconfig, turns a schema file into precomputed tables
+
+To the extent possible under law, the author(s) have dedicated all copyright and related and neighboring
+rights to this software to the public domain worldwide. This software is distributed without any warranty.
+You should have received a copy of the CC0 Public Domain Dedication along with this software.
+If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+*/
+
+/*
+lcfggen usage:
+    cc -O2 -o lcfggen tools/lcfggen.c
+    lcfggen schema.txt ids.h tables.h
+    The ID header defines one ID constant per config value and can be included anywhere. The tables file
+    must only be used through LCONFIG_TABLES, i.e. #define LCONFIG_TABLES "tables.h" before including the
+    lconfig implementation (in place of LCONFIG_TEMPLATE). IDs are assigned densely per data type.
+
+lcfggen schema:
+    The schema mirrors the template macros, one entry per line, fields separated by single spaces:
+        line TEXT                   -> LCONFIG_LINE("TEXT"), TEXT is the rest of the line (may be empty)
+        int ID NAME MIN MAX DEF     -> LCONFIG_INT(ID, "NAME", MIN, MAX, DEF)
+        str ID NAME LEN DEF         -> LCONFIG_STR(ID, "NAME", LEN, "DEF"), DEF is the rest of the line
+        map ID NAME NUM MIN MAX DEF -> LCONFIG_MAP(ID, "NAME", NUM, MIN, MAX, DEF)
+    Empty lines and lines starting with // are ignored. TEXT is written as-is (no printf formatting).
+    Defaults are clamped/truncated at generation time, so the runtime never has to clamp them again.
+
+<lcfggen example schema begin>
+line #example
+int FOO_ANUMBER number_a -10 10 0
+line
+line #foobar
+str FOO_ASTRING string_a 32 ABCD
+int FOO_BNUMBER number_b 10 20 15
+str FOO_BSTRING string_b 16 FOO
+<lcfggen example schema end>
+*/
+
+//includes
+#include <stdint.h> //fixed width hash
+#include <stdlib.h> //memory and number parsing
+#include <string.h> //string operations
+#include <stdio.h> //reading schema, writing tables
+
+//constants
+#define GEN_LMAX 65536 //maximum schema line length
+#define GEN_TRIES 100000000 //maximum displacement seeds tried per bucket
+
+//structs
+struct gen_ent {
+    int type; //1 for int, 2 for str, 3 for map
+    int id; //dense ID within its data type
+    char* ident; //ID constant name
+    char* name; //name in config file
+    size_t nlen; //length of name
+    long min, max, def; //int limits and default
+    long len; //str maximum length, map maximum number of entries
+    char* sdef; //str default
+    char* pre; //literal lines preceding this entry in the write image
+    int slot; //perfect hash slot
+};
+
+//globals
+static struct gen_ent* ents; //all entries in schema order
+static int nents, nints, nstrs, nmaps;
+static char* trail; //literal lines after the last entry
+static int* bsize; //number of entries per perfect hash bucket
+
+//function declarations
+static uint32_t genHash(const char*, size_t, uint32_t);
+static char* genDup(const char*, size_t);
+static char* genCat(char*, const char*);
+static void genFail(const char*, int, const char*);
+static void genQuote(FILE*, const char*, size_t);
+static int genCompare(const void*, const void*);
+
+//entry point
+int main (int argc, char** argv) {
+    if (argc != 4) {
+        fprintf(stderr, "usage: %s schema.txt ids.h tables.h\n", argv[0]);
+        return 1;
+    }
+    FILE* sch = fopen(argv[1], "r");
+    if (!sch) genFail(argv[1], 0, "could not open schema");
+    //parse schema into entries, collecting literal lines as prefixes
+    static char txt[GEN_LMAX];
+    char* pre = genDup("", 0);
+    int cap = 0, num = 0;
+    while (fgets(txt, GEN_LMAX, sch)) {
+        num++;
+        txt[strcspn(txt, "\r\n")] = 0;
+        if ((!txt[0])||(strncmp(txt, "//", 2) == 0)) continue;
+        if ((strncmp(txt, "line", 4) == 0)&&((!txt[4])||(txt[4] == ' '))) {
+            pre = genCat(pre, txt[4] ? &txt[5] : "");
+            pre = genCat(pre, "\n");
+            continue;
+        }
+        struct gen_ent ent = {0};
+        char* fld[6] = {0};
+        int nfld = 0, max = 0;
+        if (strncmp(txt, "int ", 4) == 0) ent.type = 1, max = 6;
+        else if (strncmp(txt, "str ", 4) == 0) ent.type = 2, max = 5;
+        else if (strncmp(txt, "map ", 4) == 0) ent.type = 3, max = 7;
+        else genFail(argv[1], num, "expected line, int, str or map");
+        for (char* c = txt; nfld < max; ) { //split fields, last str field keeps its spaces
+            fld[nfld++] = c;
+            if ((nfld == max)&&(ent.type == 2)) break;
+            c = strchr(c, ' ');
+            if (!c) break;
+            *c++ = 0;
+        }
+        if (nfld != max) genFail(argv[1], num, "wrong number of fields");
+        char* end;
+        ent.ident = genDup(fld[1], strlen(fld[1]));
+        ent.name = genDup(fld[2], ent.nlen = strlen(fld[2]));
+        if (!ent.nlen) genFail(argv[1], num, "empty name");
+        if (ent.type != 2) {
+            char** lim = &fld[(ent.type == 3) ? 4 : 3]; //maps have NUM before MIN/MAX/DEF
+            if (ent.type == 3) {
+                ent.len = strtol(fld[3], &end, 0);
+                if ((*end)||(ent.len < 0)||(ent.len > 1000000000)) genFail(argv[1], num, "invalid NUM");
+            }
+            ent.min = strtol(lim[0], &end, 0);
+            if (*end) genFail(argv[1], num, "invalid MIN");
+            ent.max = strtol(lim[1], &end, 0);
+            if (*end) genFail(argv[1], num, "invalid MAX");
+            ent.def = strtol(lim[2], &end, 0);
+            if (*end) genFail(argv[1], num, "invalid DEF");
+            if ((ent.min < -2147483647-1)||(ent.max > 2147483647)||(ent.min > ent.max))
+                genFail(argv[1], num, "invalid MIN/MAX range");
+            if (ent.def < ent.min) ent.def = ent.min;
+            if (ent.def > ent.max) ent.def = ent.max;
+            ent.id = (ent.type == 3) ? nmaps++ : nints++;
+        } else {
+            ent.len = strtol(fld[3], &end, 0);
+            if ((*end)||(ent.len < 0)) genFail(argv[1], num, "invalid LEN");
+            size_t dlen = strlen(fld[4]);
+            if (dlen > (size_t)ent.len) dlen = ent.len;
+            ent.sdef = genDup(fld[4], dlen);
+            ent.id = nstrs++;
+        }
+        ent.pre = (ent.type == 3) ? pre : genCat(genCat(pre, ent.name), " "); //maps print names per entry
+        pre = genDup("", 0);
+        if (nents == cap) ents = realloc(ents, (cap = cap ? cap*2 : 256)*sizeof(struct gen_ent));
+        if (!ents) genFail(argv[1], num, "out of memory");
+        ents[nents++] = ent;
+    }
+    trail = pre;
+    fclose(sch);
+    //build perfect hash by hash-and-displace, largest buckets placed first
+    int nslots = nents + nents/8 + 1, nbucks = nents/4 + 1;
+    uint32_t* seeds = calloc(nbucks, sizeof(uint32_t));
+    int* order = malloc((nents + 1)*sizeof(int));
+    int* bfirst = calloc(nbucks + 1, sizeof(int));
+    int* bfill = calloc(nbucks, sizeof(int));
+    int* border = malloc(nbucks*sizeof(int));
+    char* taken = calloc(nslots, 1);
+    bsize = calloc(nbucks, sizeof(int));
+    if ((!seeds)||(!order)||(!bsize)||(!bfirst)||(!bfill)||(!border)||(!taken))
+        genFail(argv[1], 0, "out of memory");
+    for (int i = 0; i < nents; i++) bsize[genHash(ents[i].name, ents[i].nlen, 0)%nbucks]++;
+    for (int b = 0; b < nbucks; b++) bfirst[b+1] = bfirst[b] + bsize[b];
+    for (int i = 0; i < nents; i++) {
+        int b = genHash(ents[i].name, ents[i].nlen, 0)%nbucks;
+        order[bfirst[b] + bfill[b]++] = i;
+    }
+    for (int b = 0; b < nbucks; b++) border[b] = b;
+    qsort(border, nbucks, sizeof(int), genCompare);
+    for (int n = 0; n < nbucks; n++) {
+        int b = border[n], cnt = bsize[b];
+        if (!cnt) break;
+        int* key = &order[bfirst[b]];
+        for (int i = 0; i < cnt; i++) for (int j = i + 1; j < cnt; j++)
+            if (strcmp(ents[key[i]].name, ents[key[j]].name) == 0) {
+                fprintf(stderr, "%s: duplicate name '%s'\n", argv[1], ents[key[i]].name);
+                return 1;
+            }
+        uint32_t seed = 1;
+        for (; seed < GEN_TRIES; seed++) {
+            int i = 0;
+            for (; i < cnt; i++) {
+                int s = genHash(ents[key[i]].name, ents[key[i]].nlen, seed)%nslots;
+                if (taken[s]) break;
+                taken[s] = 1;
+                ents[key[i]].slot = s;
+            }
+            if (i == cnt) break;
+            while (i--) taken[ents[key[i]].slot] = 0; //undo partial placement
+        }
+        if (seed == GEN_TRIES) genFail(argv[1], 0, "could not build perfect hash");
+        seeds[b] = seed;
+    }
+    //write ID header
+    FILE* ids = fopen(argv[2], "w");
+    if (!ids) genFail(argv[2], 0, "could not open ID header");
+    fprintf(ids, "//generated by lcfggen from %s, do not edit\n", argv[1]);
+    for (int i = 0; i < nents; i++) fprintf(ids, "#define %s %d\n", ents[i].ident, ents[i].id);
+    if (fclose(ids)) genFail(argv[2], 0, "could not write ID header");
+    //write tables, consumed by lconfig.h through LCONFIG_TABLES
+    FILE* tab = fopen(argv[3], "w");
+    if (!tab) genFail(argv[3], 0, "could not open tables");
+    fprintf(tab, "//generated by lcfggen from %s, do not edit\n", argv[1]);
+    fprintf(tab, "static struct lcfg_int lcfg_ints[] = {\n");
+    if (!nints) fprintf(tab, "    {0},\n");
+    for (int i = 0; i < nents; i++) if (ents[i].type == 1) {
+        fprintf(tab, "    {");
+        genQuote(tab, ents[i].name, ents[i].nlen);
+        fprintf(tab, " \", %ld, %ld, %ld, %ld},\n", ents[i].min, ents[i].max, ents[i].def, ents[i].def);
+    }
+    fprintf(tab, "};\nstatic struct lcfg_str lcfg_strs[] = {\n");
+    if (!nstrs) fprintf(tab, "    {0},\n");
+    for (int i = 0; i < nents; i++) if (ents[i].type == 2) {
+        fprintf(tab, "    {");
+        genQuote(tab, ents[i].name, ents[i].nlen);
+        fprintf(tab, " \", %ld, ", ents[i].len);
+        genQuote(tab, ents[i].sdef, strlen(ents[i].sdef));
+        fprintf(tab, "\", (char[%ld]){", ents[i].len + 1);
+        genQuote(tab, ents[i].sdef, strlen(ents[i].sdef));
+        fprintf(tab, "\"}},\n");
+    }
+    fprintf(tab, "};\nstatic struct lcfg_map lcfg_maps[] = {\n");
+    if (!nmaps) fprintf(tab, "    {0},\n");
+    for (int i = 0; i < nents; i++) if (ents[i].type == 3) {
+        fprintf(tab, "    {");
+        genQuote(tab, ents[i].name, ents[i].nlen);
+        fprintf(tab, " \", %ld, %ld, %ld, %ld},\n", ents[i].len, ents[i].min, ents[i].max, ents[i].def);
+    }
+    fprintf(tab, "};\nstatic const uint32_t lcfg_seeds[] = {");
+    for (int b = 0; b < nbucks; b++) fprintf(tab, "%s%lu,", (b%16) ? "" : "\n    ", (unsigned long)seeds[b]);
+    fprintf(tab, "\n};\nstatic const struct lcfg_key lcfg_keys[] = {\n");
+    int* slots = malloc(nslots*sizeof(int));
+    if (!slots) genFail(argv[3], 0, "out of memory");
+    for (int s = 0; s < nslots; s++) slots[s] = -1;
+    for (int i = 0; i < nents; i++) slots[ents[i].slot] = i;
+    for (int s = 0; s < nslots; s++) {
+        if (slots[s] < 0) fprintf(tab, "    {0},\n");
+        else fprintf(tab, "    {%d, %d, %lu},\n", ents[slots[s]].type, ents[slots[s]].id,
+            (unsigned long)ents[slots[s]].nlen + 1);
+    }
+    fprintf(tab, "};\nstatic const struct lcfg_lay lcfg_lays[] = {\n");
+    for (int i = 0; i < nents; i++) {
+        fprintf(tab, "    {");
+        genQuote(tab, ents[i].pre, strlen(ents[i].pre));
+        fprintf(tab, "\", %d, %d},\n", ents[i].type, ents[i].id);
+    }
+    fprintf(tab, "    {");
+    genQuote(tab, trail, strlen(trail));
+    fprintf(tab, "\", 0, 0},\n};\n");
+    if (fclose(tab)) genFail(argv[3], 0, "could not write tables");
+    return 0;
+}
+
+//internal functions
+static uint32_t genHash (const char* key, size_t len, uint32_t seed) {
+    //must match lcfgHash in lconfig.h exactly
+    uint32_t h = 2166136261u ^ seed;
+    for (size_t i = 0; i < len; i++) h = (h ^ (unsigned char)key[i])*16777619u;
+    h ^= h >> 16;
+    h *= 0x85ebca6bu;
+    h ^= h >> 13;
+    return h;
+}
+static char* genDup (const char* str, size_t len) {
+    char* dup = malloc(len + 1);
+    if (!dup) genFail("lcfggen", 0, "out of memory");
+    memcpy(dup, str, len);
+    dup[len] = 0;
+    return dup;
+}
+static char* genCat (char* str, const char* app) {
+    size_t slen = strlen(str), alen = strlen(app);
+    str = realloc(str, slen + alen + 1);
+    if (!str) genFail("lcfggen", 0, "out of memory");
+    memcpy(&str[slen], app, alen + 1);
+    return str;
+}
+static void genFail (const char* path, int line, const char* msg) {
+    if (line) fprintf(stderr, "%s:%d: %s\n", path, line, msg);
+    else fprintf(stderr, "%s: %s\n", path, msg);
+    exit(1);
+}
+static void genQuote (FILE* fpt, const char* str, size_t len) {
+    //opens a C string literal and writes str escaped, caller closes the literal
+    fputc('"', fpt);
+    for (size_t i = 0; i < len; i++) {
+        unsigned char c = str[i];
+        if (c == '\n') fputs("\\n", fpt);
+        else if ((c == '"')||(c == '\\')||(c == '?')) fprintf(fpt, "\\%c", c);
+        else if ((c < 32)||(c > 126)) fprintf(fpt, "\\%03o", c);
+        else fputc(c, fpt);
+    }
+}
+static int genCompare (const void* a, const void* b) {
+    //sorts bucket indices by descending bucket size
+    return bsize[*(const int*)b] - bsize[*(const int*)a];
+}
@@ -0,0 +1,271 @@
+/*
+lcfglint.c - Parallel validator checking many config files against an lconfig template or lcfggen tables
+
+To the extent possible under law, the author(s) have dedicated all copyright and related and neighboring
+rights to this software to the public domain worldwide. This software is distributed without any warranty.
+You should have received a copy of the CC0 Public Domain Dedication along with this software.
+If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+*/
+
+/*
+lcfglint usage:
+    Since templates are fixed at compile time, lcfglint is built against the same template (a header that
+    defines LCONFIG_TEMPLATE) or lcfggen tables as the program whose config files it checks:
+        cc -O2 -pthread -I. -DLCFGLINT_TEMPLATE='"template.h"' -o lcfglint tools/lcfglint.c
+        cc -O2 -pthread -I. -DLCFGLINT_TABLES='"tables.h"' -o lcfglint tools/lcfglint.c
+        ./lcfglint -j 8 web/config.txt db/config.txt
+        find hosts -name config.txt | ./lcfglint -j 8 -
+    Every file is read into memory once and checked line by line the way lconfigRead reads it (including
+    sections), but nothing is applied, so files are checked independently and in parallel. Problems are
+    reported as PATH:LINE: message, in the order the files were given, followed by a summary line for each
+    file with problems. Exits with 0 if all files are clean, 1 if any has problems, 2 if any is unreadable.
+
+lcfglint options:
+    -j THREADS  number of threads checking files (default 4)
+    -s          summary lines only, without the individual problems
+    -           reads further paths from stdin, one per line (for more files than fit on a command line)
+
+lcfglint checks:
+    unknown     lines matching no config value (blank lines, # lines and section headers excluded)
+    clamped     int and map values outside of MIN/MAX, which lconfigRead would clamp
+    truncated   string values longer than LEN, which lconfigRead would truncate
+    duplicate   config values set more than once in the same file, where the last one wins (maps excluded)
+    invalid     int and map values with trailing garbage or without any digits, map lines without a value,
+                and lines longer than LCONFIG_LMAX, which lconfigRead splits unless it loads whole files
+*/
+
+//includes
+#define _POSIX_C_SOURCE 200809L //getline, open_memstream
+#include <pthread.h> //checker threads
+#include <stdlib.h> //memory and argument parsing
+#include <string.h> //string operations
+#include <stdio.h> //config files and reporting
+
+//template
+#if defined(LCFGLINT_TEMPLATE)
+    #include LCFGLINT_TEMPLATE
+#elif defined(LCFGLINT_TABLES)
+    #define LCONFIG_TABLES LCFGLINT_TABLES
+#else
+    #error "LCFGLINT_TEMPLATE or LCFGLINT_TABLES must be defined (see usage)"
+#endif
+#define LCONFIG_STATIC
+#include "../lconfig.h"
+
+//structs
+struct lint_file {
+    const char* path; //path as given
+    char* out; //report, NULL until checked
+    size_t olen; //length of out
+    int err; //0 if clean, 1 if problems were found, 2 if the file could not be read
+};
+struct lint_seen {
+    unsigned gen; //file in which the config value was last seen, per thread
+    int line; //line on which it was last set in that file
+};
+struct lint_thread {
+    struct lint_seen* ints; //one entry per int ID
+    struct lint_seen* strs; //one entry per string ID
+    unsigned gen; //files checked by this thread so far
+};
+
+//function declarations
+static void* lintRun(void*);
+static void lintFile(struct lint_file*, struct lint_thread*);
+static char* lintSlurp(FILE*);
+static int lintAdd(const char*);
+
+//globals
+static struct lint_file* lint_files; //all files in order, grown while parsing arguments
+static int lint_nfiles, lint_cap;
+static int lint_next; //next file to check, taken under lint_lock
+static int lint_summary; //1 to only report summary lines
+static pthread_mutex_t lint_lock = PTHREAD_MUTEX_INITIALIZER;
+
+//entry point
+int main (int argc, char** argv) {
+    int threads = 4;
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-j") == 0)&&(i + 1 < argc)) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0) {
+            lint_summary = 1;
+        } else if (strcmp(argv[i], "-") == 0) {
+            char* line = NULL;
+            size_t cap = 0;
+            for (ssize_t len; (len = getline(&line, &cap, stdin)) > 0; ) {
+                line[strcspn(line, "\r\n")] = 0;
+                if ((line[0])&&(lintAdd(line))) return 2;
+            }
+            free(line);
+        } else if (lintAdd(argv[i])) {
+            return 2;
+        }
+    }
+    if (!lint_nfiles) {
+        fprintf(stderr, "usage: %s [-j THREADS] [-s] FILE... (- reads paths from stdin)\n", argv[0]);
+        return 2;
+    }
+    if (threads < 1) threads = 1;
+    if (threads > lint_nfiles) threads = lint_nfiles;
+    #ifndef LCONFIG_TABLES
+    lcfgIndex(); //before any thread looks up names
+    #endif
+    pthread_t* thr = malloc(threads*sizeof(pthread_t));
+    int* started = calloc(threads, sizeof(int));
+    if ((!thr)||(!started)) return 2;
+    for (int i = 1; i < threads; i++) started[i] = (pthread_create(&thr[i], NULL, lintRun, NULL) == 0);
+    lintRun(NULL); //the main thread checks files too, so it works even without extra threads
+    for (int i = 1; i < threads; i++) if (started[i]) pthread_join(thr[i], NULL);
+    //report in the order files were given, so the output does not depend on scheduling
+    int bad = 0, unreadable = 0, err = 0;
+    for (int i = 0; i < lint_nfiles; i++) {
+        if (lint_files[i].out) fwrite(lint_files[i].out, 1, lint_files[i].olen, stdout);
+        bad += (lint_files[i].err == 1);
+        unreadable += (lint_files[i].err == 2);
+        if (lint_files[i].err > err) err = lint_files[i].err;
+    }
+    printf("%d files checked, %d with problems, %d unreadable\n", lint_nfiles, bad, unreadable);
+    return err;
+}
+
+//internal functions
+static void* lintRun (void* arg) {
+    //checks files until none are left
+    struct lint_thread thr = {calloc(LCFG_NINTS + 1, sizeof(struct lint_seen)),
+        calloc(LCFG_NSTRS + 1, sizeof(struct lint_seen)), 0};
+    for (;;) {
+        pthread_mutex_lock(&lint_lock);
+        int idx = lint_next++;
+        pthread_mutex_unlock(&lint_lock);
+        if (idx >= lint_nfiles) break;
+        lintFile(&lint_files[idx], &thr);
+    }
+    free(thr.ints);
+    free(thr.strs);
+    (void)arg;
+    return NULL;
+}
+static void lintFile (struct lint_file* file, struct lint_thread* thr) {
+    //checks a single file, writing the report into file->out
+    FILE* out = open_memstream(&file->out, &file->olen);
+    FILE* cfg = fopen(file->path, "rb");
+    char* buf = cfg ? lintSlurp(cfg) : NULL;
+    if (cfg) fclose(cfg);
+    if ((!out)||(!buf)||(!thr->ints)||(!thr->strs)) {
+        if (out) fprintf(out, "%s: cannot be read\n", file->path);
+        if (out) fclose(out);
+        free(buf);
+        file->err = 2;
+        return;
+    }
+    thr->gen++;
+    int unknown = 0, clamped = 0, truncated = 0, duplicate = 0, invalid = 0;
+    char sec[LCONFIG_LMAX];
+    size_t slen = 0;
+    int line = 0;
+    for (char* txt = buf; *txt; ) {
+        char* eol = &txt[strcspn(txt, "\n")];
+        int nl = (*eol == '\n');
+        *eol = 0;
+        line++;
+        int type = 0, id = 0;
+        const char* val = NULL;
+        if ((size_t)(eol - txt) + nl > LCONFIG_LMAX - 1) { //fgets would return it in pieces
+            invalid++;
+            if (!lint_summary) fprintf(out, "%s:%d: invalid, longer than LCONFIG_LMAX\n", file->path, line);
+        }
+        int header = lcfgSection(txt, sec, &slen);
+        if (!header) val = lcfgResolve(txt, sec, slen, &type, &id);
+        if ((!type)&&(!header)&&(txt[0] != '#')&&(txt[strspn(txt, " \t\r")])) {
+            unknown++;
+            if (!lint_summary)
+                fprintf(out, "%s:%d: unknown, %.*s\n", file->path, line, (int)strcspn(txt, " "), txt);
+        }
+        if ((type == LCFG_INT)||(type == LCFG_STR)) {
+            struct lint_seen* seen = (type == LCFG_INT) ? &thr->ints[id] : &thr->strs[id];
+            const char* name = lcfgName(type, id);
+            if (seen->gen == thr->gen) {
+                duplicate++;
+                if (!lint_summary) fprintf(out, "%s:%d: duplicate, %.*s already set on line %d\n",
+                    file->path, line, (int)strlen(name) - 1, name, seen->line);
+            }
+            seen->gen = thr->gen;
+            seen->line = line;
+        }
+        if (type == LCFG_INT) {
+            const struct lcfg_int* cfg = lcfgInt(id);
+            int num = cfg->def, err = lcfgParse(val, &num);
+            if (err) {
+                invalid++;
+                if (!lint_summary) fprintf(out, "%s:%d: invalid, %s\n", file->path, line, txt);
+            }
+            if ((err >= 0)&&((num < cfg->min)||(num > cfg->max))) {
+                clamped++;
+                if (!lint_summary) fprintf(out, "%s:%d: clamped, %s is outside of %d to %d\n",
+                    file->path, line, txt, cfg->min, cfg->max);
+            }
+        } else if (type == LCFG_STR) {
+            const struct lcfg_str* cfg = lcfgStr(id);
+            if (strlen(val) > (size_t)cfg->len) {
+                truncated++;
+                if (!lint_summary) fprintf(out, "%s:%d: truncated, %s is longer than %d characters\n",
+                    file->path, line, txt, cfg->len);
+            }
+        } else if (type == LCFG_MAP) {
+            const struct lcfg_map* cfg = lcfgMap(id);
+            size_t len = strcspn(val, " ");
+            int num = cfg->def, err = ((len)&&(val[len] == ' ')) ? lcfgParse(&val[len+1], &num) : -1;
+            if (err) {
+                invalid++;
+                if (!lint_summary) fprintf(out, "%s:%d: invalid, %s\n", file->path, line, txt);
+            }
+            if ((err >= 0)&&((num < cfg->min)||(num > cfg->max))) {
+                clamped++;
+                if (!lint_summary) fprintf(out, "%s:%d: clamped, %s is outside of %d to %d\n",
+                    file->path, line, txt, cfg->min, cfg->max);
+            }
+        }
+        txt = eol + nl;
+    }
+    if (unknown + clamped + truncated + duplicate + invalid) {
+        fprintf(out, "%s: %d unknown, %d clamped, %d truncated, %d duplicate, %d invalid\n",
+            file->path, unknown, clamped, truncated, duplicate, invalid);
+        file->err = 1;
+    }
+    fclose(out);
+    free(buf);
+}
+static char* lintSlurp (FILE* fpt) {
+    //reads a whole file into a NUL terminated buffer, returns NULL on failure
+    size_t len = 0, cap = 4096;
+    char* buf = malloc(cap);
+    while (buf) {
+        len += fread(&buf[len], 1, cap - len - 1, fpt);
+        if (len < cap - 1) break;
+        char* big = realloc(buf, cap*2);
+        if (!big) free(buf);
+        buf = big;
+        cap *= 2;
+    }
+    if ((buf)&&(ferror(fpt))) {
+        free(buf);
+        return NULL;
+    }
+    if (buf) buf[len] = 0;
+    return buf;
+}
+static int lintAdd (const char* path) {
+    //appends a file to check, returns 1 if out of memory
+    if (lint_nfiles == lint_cap) {
+        int cap = lint_cap ? lint_cap*2 : 256;
+        struct lint_file* files = realloc(lint_files, cap*sizeof(struct lint_file));
+        if (!files) return 1;
+        lint_files = files;
+        lint_cap = cap;
+    }
+    struct lint_file file = {strdup(path), NULL, 0, 0};
+    if (!file.path) return 1;
+    lint_files[lint_nfiles++] = file;
+    return 0;
+}
@@ -0,0 +1,238 @@
+/*
+lcfgreplay.c - Replays call traces captured with LCONFIG_CAPTURE and reports their latencies
+
+To the extent possible under law, the author(s) have dedicated all copyright and related and neighboring
+rights to this software to the public domain worldwide. This software is distributed without any warranty.
+You should have received a copy of the CC0 Public Domain Dedication along with this software.
+If not, see <http://creativecommons.org/publicdomain/zero/1.0/>.
+*/
+
+/*
+lcfgreplay usage:
+    A trace is captured by a program built with LCONFIG_CAPTURE, which calls lconfigCapture("trace.bin") at
+    the start of the period of interest and lconfigCapture(NULL) at its end. Since templates are fixed at
+    compile time, lcfgreplay is built against the same template (a header that defines LCONFIG_TEMPLATE) or
+    lcfggen tables as that program, and run next to a copy of its config file, as replayed writes replace it:
+        cc -O2 -pthread -I. -DLCFGREPLAY_TEMPLATE='"template.h"' -o lcfgreplay tools/lcfgreplay.c
+        cc -O2 -pthread -I. -DLCFGREPLAY_TABLES='"tables.h"' -o lcfgreplay tools/lcfgreplay.c
+        ./lcfgreplay -m threads -r 5 trace.bin
+    Every repetition replays the whole trace, starting from the config values as they are after an initial
+    lconfigRead. Reports the wall time of the fastest repetition, and for each call type the number of calls
+    and latency percentiles over all repetitions. The config file is config.txt, unless the build adds
+    -DLCONFIG_PATH='"path"' like the captured program.
+
+lcfgreplay options:
+    -m MODE     threads replays the calls of each captured thread on a thread of its own, single replays
+                all calls on the main thread in time order (default threads)
+    -p          paced, waits until each call is due as captured instead of replaying as fast as possible
+    -r REPS     repetitions of the whole trace (default 1)
+*/
+
+//includes
+#define _POSIX_C_SOURCE 200809L //clock_gettime, nanosleep
+#include <pthread.h> //replay threads
+#include <stdlib.h> //memory and argument parsing
+#include <string.h> //string operations
+#include <stdio.h> //trace file and reporting
+#include <time.h> //monotonic clock
+
+//template
+#if defined(LCFGREPLAY_TEMPLATE)
+    #include LCFGREPLAY_TEMPLATE
+#elif defined(LCFGREPLAY_TABLES)
+    #define LCONFIG_TABLES LCFGREPLAY_TABLES
+#else
+    #error "LCFGREPLAY_TEMPLATE or LCFGREPLAY_TABLES must be defined (see usage)"
+#endif
+#define LCONFIG_CAPTURE //trace format, replaying never captures
+#define LCONFIG_STATIC
+#include "../lconfig.h"
+
+//constants
+#define REPLAY_OPS 7 //LCONFIG_C* constants are 1 to 6
+
+//structs
+struct replay_call {
+    struct lconfig_rec rec; //as captured
+    char* str; //NUL terminated string for LCONFIG_CSETSTR, NULL otherwise
+    size_t idx; //position in the trace file, keeps sorting stable
+};
+struct replay_worker {
+    struct replay_call* calls; //calls in time order
+    size_t num; //number of calls
+    float* lat; //latency of each call in the current repetition, nanoseconds
+    long sum; //getter results, keeps them from being optimized out
+};
+
+//function declarations
+static void* replayRun(void*);
+static double replayNow();
+static void replayWait(double);
+static int replayCallCompare(const void*, const void*);
+static int replayFloatCompare(const void*, const void*);
+
+//globals
+static double replay_start; //time at which all replay threads start, including the main thread
+static int replay_paced; //1 to keep the captured timing
+
+//entry point
+int main (int argc, char** argv) {
+    int reps = 1, single = 0;
+    const char* path = NULL;
+    for (int i = 1; i < argc; i++) {
+        if ((strcmp(argv[i], "-m") == 0)&&(i + 1 < argc)) single = (strcmp(argv[++i], "single") == 0);
+        else if ((strcmp(argv[i], "-r") == 0)&&(i + 1 < argc)) reps = atoi(argv[++i]);
+        else if (strcmp(argv[i], "-p") == 0) replay_paced = 1;
+        else path = argv[i];
+    }
+    if (reps < 1) reps = 1;
+    if (!path) {
+        fprintf(stderr, "usage: %s [-m threads|single] [-p] [-r REPS] TRACE\n", argv[0]);
+        return 1;
+    }
+    //load the whole trace
+    FILE* fpt = fopen(path, "rb");
+    if (!fpt) {
+        fprintf(stderr, "%s cannot be read\n", path);
+        return 1;
+    }
+    fseek(fpt, 0, SEEK_END);
+    long size = ftell(fpt);
+    rewind(fpt);
+    char* buf = malloc(size > 0 ? size : 1);
+    if ((!buf)||(size < 8)||(fread(buf, 1, size, fpt) != (size_t)size)||(memcmp(buf, "LCFGCAP1", 8))) {
+        fprintf(stderr, "%s is not an lconfig trace\n", path);
+        return 1;
+    }
+    fclose(fpt);
+    size_t num = 0, cap = 1024;
+    struct replay_call* calls = malloc(cap*sizeof(struct replay_call));
+    int threads = 0;
+    for (long pos = 8; pos + (long)sizeof(struct lconfig_rec) <= size; num++) {
+        if (num == cap) calls = realloc(calls, (cap *= 2)*sizeof(struct replay_call));
+        if (!calls) return 1;
+        struct replay_call call = {{0}, NULL, num};
+        memcpy(&call.rec, &buf[pos], sizeof(call.rec));
+        pos += sizeof(call.rec);
+        if ((call.rec.op == LCONFIG_CSETSTR)&&(pos + call.rec.len <= size)) {
+            if (!(call.str = malloc(call.rec.len + 1))) return 1;
+            memcpy(call.str, &buf[pos], call.rec.len);
+            call.str[call.rec.len] = 0;
+            pos += call.rec.len;
+        }
+        int bad = (call.rec.op == 0)||(call.rec.op >= REPLAY_OPS);
+        if ((bad)||((call.rec.op == LCONFIG_CSETSTR)&&(!call.str))) {
+            fprintf(stderr, "%s is corrupt after %zu calls\n", path, num);
+            return 1;
+        }
+        if ((int)call.rec.thread >= threads) threads = call.rec.thread + 1;
+        calls[num] = call;
+    }
+    free(buf);
+    if (!num) {
+        fprintf(stderr, "%s holds no calls\n", path);
+        return 1;
+    }
+    qsort(calls, num, sizeof(struct replay_call), replayCallCompare);
+    printf("trace %zu calls, %d threads, %.3f s captured\n", num, threads, calls[num-1].rec.ns*1e-9);
+    //one worker per captured thread, or a single one taking all calls in time order
+    int workers = single ? 1 : threads;
+    struct replay_worker* work = calloc(workers, sizeof(struct replay_worker));
+    float* lat = malloc(num*sizeof(float)*reps);
+    struct replay_call* order = malloc(num*sizeof(struct replay_call));
+    if ((!work)||(!lat)||(!order)) return 1;
+    size_t at = 0;
+    for (int w = 0; w < workers; w++) { //calls of each worker are contiguous in order
+        work[w].calls = &order[at];
+        for (size_t i = 0; i < num; i++)
+            if ((single)||((int)calls[i].rec.thread == w)) order[at++] = calls[i];
+        work[w].num = &order[at] - work[w].calls;
+    }
+    lconfigRead();
+    pthread_t* thr = malloc(workers*sizeof(pthread_t));
+    int* started = calloc(workers, sizeof(int));
+    if ((!thr)||(!started)) return 1;
+    double best = 0;
+    for (int r = 0; r < reps; r++) {
+        for (int w = 0; w < workers; w++) work[w].lat = &lat[r*num + (work[w].calls - order)];
+        replay_start = replayNow() + 0.01; //gives the threads time to start before the first call is due
+        for (int w = 1; w < workers; w++)
+            started[w] = (pthread_create(&thr[w], NULL, replayRun, &work[w]) == 0);
+        replayRun(&work[0]);
+        for (int w = 1; w < workers; w++) {
+            if (started[w]) pthread_join(thr[w], NULL);
+            else replayRun(&work[w]); //no thread available, replay it here afterwards
+        }
+        double took = replayNow() - replay_start;
+        if ((r == 0)||(took < best)) best = took;
+    }
+    printf("replay %s%s, best of %d: %.3f ms, %.2f Mcalls/s\n", single ? "single" : "threads",
+        replay_paced ? " paced" : "", reps, best*1e3, num/best*1e-6);
+    //latency percentiles per call type over all repetitions
+    static const char* names[REPLAY_OPS] = {"", "lconfigGetInt", "lconfigGetString", "lconfigSetInt",
+        "lconfigSetString", "lconfigRead", "lconfigWrite"};
+    float* sel = malloc(num*sizeof(float)*reps);
+    if (!sel) return 1;
+    printf("%-16s %10s %10s %10s %10s %12s\n", "call", "count", "p50 ns", "p90 ns", "p99 ns", "max ns");
+    for (int op = 1; op < REPLAY_OPS; op++) {
+        size_t cnt = 0;
+        for (int r = 0; r < reps; r++)
+            for (size_t i = 0; i < num; i++) if (order[i].rec.op == op) sel[cnt++] = lat[r*num + i];
+        if (!cnt) continue;
+        qsort(sel, cnt, sizeof(float), replayFloatCompare);
+        printf("%-16s %10zu %10.0f %10.0f %10.0f %12.0f\n", names[op], cnt/reps, sel[cnt/2], sel[cnt*9/10],
+            sel[cnt*99/100], sel[cnt-1]);
+    }
+    long sum = 0;
+    for (int w = 0; w < workers; w++) sum += work[w].sum;
+    return sum == 42; //keeps getter results from being optimized out
+}
+
+//internal functions
+static void* replayRun (void* arg) {
+    //replays the calls of one worker, timing each of them
+    struct replay_worker* work = arg;
+    replayWait(replay_start);
+    long sum = 0;
+    for (size_t i = 0; i < work->num; i++) {
+        const struct lconfig_rec* rec = &work->calls[i].rec;
+        if (replay_paced) replayWait(replay_start + rec->ns*1e-9);
+        double s = replayNow();
+        switch (rec->op) {
+            case LCONFIG_CGETINT: sum += lconfigGetInt(rec->id); break;
+            case LCONFIG_CGETSTR: sum += (long)(size_t)lconfigGetString(rec->id); break;
+            case LCONFIG_CSETINT: lconfigSetInt(rec->id, rec->val); break;
+            case LCONFIG_CSETSTR: lconfigSetString(rec->id, work->calls[i].str); break;
+            case LCONFIG_CREAD: sum += lconfigRead(); break;
+            case LCONFIG_CWRITE: sum += lconfigWrite(); break;
+        }
+        work->lat[i] = (float)((replayNow() - s)*1e9);
+    }
+    work->sum += sum;
+    return NULL;
+}
+static double replayNow () {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+static void replayWait (double until) {
+    //sleeps until the given time, spinning for the last 50 microseconds to be on time
+    for (double now; (now = replayNow()) < until; ) {
+        if (until - now > 50e-6) {
+            double sec = until - now - 50e-6;
+            struct timespec ts = {(time_t)sec, (long)((sec - (time_t)sec)*1e9)};
+            nanosleep(&ts, NULL);
+        }
+    }
+}
+static int replayCallCompare (const void* a, const void* b) {
+    const struct replay_call* x = a;
+    const struct replay_call* y = b;
+    if (x->rec.ns != y->rec.ns) return (x->rec.ns < y->rec.ns) ? -1 : 1;
+    return (x->idx < y->idx) ? -1 : (x->idx > y->idx);
+}
+static int replayFloatCompare (const void* a, const void* b) {
+    float x = *(const float*)a, y = *(const float*)b;
+    return (x < y) ? -1 : (x > y);
+}